@@ -0,0 +1,100 @@
+#ifndef __array_h__
+#define __array_h__
+
+#include<vector>
+#include<cstddef>
+#include<cassert>
+
+namespace trimesh
+{
+	/*
+	* Name: array_t
+	* Func: Array that either owns its elements in a std::vector, or borrows read-only elements stored elsewhere
+	* (e.g. a memory-mapped file) without copying them.
+	* Reading works the same in both cases. Writing requires an owning array, see "detach".
+	* @Varia m_owned: The elements when the array owns them.
+	* @Varia m_data: The elements being read, either m_owned.data() or the borrowed pointer.
+	* @Varia m_size: The number of elements.
+	*/
+	template<typename T>
+	class array_t
+	{
+	private:
+		std::vector<T> m_owned;
+		const T* m_data;
+		std::size_t m_size;
+
+		void sync()
+		{
+			m_data = m_owned.data();
+			m_size = m_owned.size();
+		}
+
+	public:
+		array_t() : m_data(nullptr), m_size(0) {}
+		array_t(const array_t& other) : m_owned(other.m_owned), m_data(other.m_data), m_size(other.m_size)
+		{
+			if (other.is_owner()) { sync(); }
+		}
+
+		array_t& operator=(const array_t& other)
+		{
+			m_owned = other.m_owned;
+			m_data = other.m_data;
+			m_size = other.m_size;
+			if (other.is_owner()) { sync(); }
+			return *this;
+		}
+
+		/*
+		* Name: borrow
+		* Func: Read "size" elements at "data" in place. The memory must outlive the array or the next call to a writing function.
+		*/
+		void borrow(const T* data, std::size_t size)
+		{
+			m_owned.clear();
+			m_owned.shrink_to_fit();
+			m_data = data;
+			m_size = size;
+		}
+
+		/*
+		* Name: detach
+		* Func: Copy borrowed elements into owned storage, so that they can be written.
+		*/
+		void detach()
+		{
+			if (!is_owner()) {
+				m_owned.assign(m_data, m_data + m_size);
+				sync();
+			}
+		}
+
+		bool is_owner() const { return m_data == m_owned.data() && m_size == m_owned.size(); }
+
+		std::size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+		const T* data() const { return m_data; }
+		const T* begin() const { return m_data; }
+		const T* end() const { return m_data + m_size; }
+		const T& operator[](std::size_t i) const { return m_data[i]; }
+		const T& back() const { return m_data[m_size - 1]; }
+
+		T* data() { assert(is_owner()); return m_owned.data(); }
+		T* begin() { assert(is_owner()); return m_owned.data(); }
+		T* end() { assert(is_owner()); return m_owned.data() + m_owned.size(); }
+		T& operator[](std::size_t i) { assert(is_owner()); return m_owned[i]; }
+		T& back() { assert(is_owner()); return m_owned.back(); }
+
+		// The writing functions below make the array own its elements. Borrowed elements are copied unless they're overwritten.
+		void clear() { m_owned.clear(); sync(); }
+		void reserve(std::size_t n) { detach(); m_owned.reserve(n); sync(); }
+		void resize(std::size_t n) { detach(); m_owned.resize(n); sync(); }
+		void resize(std::size_t n, const T& value) { detach(); m_owned.resize(n, value); sync(); }
+		void assign(std::size_t n, const T& value) { m_owned.assign(n, value); sync(); }
+		void push_back(const T& value) { detach(); m_owned.push_back(value); sync(); }
+		void swap(std::vector<T>& other) { detach(); m_owned.swap(other); sync(); }
+	};
+}
+
+#endif // !__array_h__
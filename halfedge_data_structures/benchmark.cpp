@@ -0,0 +1,297 @@
+// Benchmark of trimesh_t at production scale.
+// Times triangles2edges, build, build_from_triangles, the one-ring traversal of all vertices and vertex_adjacency
+// on generated grids (or on a mesh file), and writes the statistics over the repetitions as JSON or CSV.
+//
+// Usage: benchmark [--faces 10000,1000000,...] [--mesh file] [--repetitions 5] [--threads 1] [--shuffle]
+//                  [--format json|csv] [--output file]
+//
+// Build: g++ -std=c++17 -O2 -pthread benchmark.cpp trimesh.cpp trimesh_topology.cpp mesh_io.cpp mapped_file.cpp -o benchmark
+
+#include"trimesh.h"
+#include"mesh_io.h"
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<random>
+#include<string>
+#include<vector>
+
+#ifndef _WIN32
+#include<sys/resource.h>
+#else
+#include<windows.h>
+#include<psapi.h>
+#endif
+
+namespace
+{
+	/*
+	* Name: peak_memory
+	* Func: Return the peak resident memory of the process so far, in bytes, or 0 if unknown.
+	*/
+	std::size_t peak_memory()
+	{
+#ifndef _WIN32
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#ifdef __APPLE__
+		return std::size_t(usage.ru_maxrss);  // bytes
+#else
+		return std::size_t(usage.ru_maxrss) * 1024;  // kilobytes
+#endif
+#else
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) { return 0; }
+		return counters.PeakWorkingSetSize;
+#endif
+	}
+
+	double now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/*
+	* Name: input_t
+	* Func: A benchmark input: triangles and the number of vertices.
+	*/
+	struct input_t
+	{
+		std::string name;
+		long num_vertices = 0;
+		std::vector<trimesh::triangle_t> triangles;
+	};
+
+	/*
+	* Name: make_grid
+	* Func: Generate a regular grid of about "num_faces" triangles, optionally in random order like a triangle soup.
+	*/
+	input_t make_grid(long num_faces, bool shuffle)
+	{
+		const long width = std::max(1L, long(std::sqrt(num_faces / 2.0)));
+		const long height = std::max(1L, (num_faces / 2 + width - 1) / width);
+
+		input_t input;
+		input.name = "grid";
+		input.num_vertices = (width + 1) * (height + 1);
+		input.triangles.reserve(2 * width * height);
+		for (long y = 0; y < height; ++y) {
+			for (long x = 0; x < width; ++x) {
+				const long v00 = y * (width + 1) + x, v10 = v00 + 1, v01 = v00 + width + 1, v11 = v01 + 1;
+				trimesh::triangle_t t;
+				t.i() = v00; t.j() = v10; t.k() = v11;
+				input.triangles.push_back(t);
+				t.i() = v00; t.j() = v11; t.k() = v01;
+				input.triangles.push_back(t);
+			}
+		}
+		if (shuffle) {
+			std::mt19937_64 random(1);
+			std::shuffle(input.triangles.begin(), input.triangles.end(), random);
+		}
+		return input;
+	}
+
+	/*
+	* Name: result_t
+	* Func: Statistics of one stage over the repetitions, in seconds.
+	* @Varia peak_memory: The peak of the whole process when the stage ended, not of the stage: reported as process_peak_memory_bytes.
+	*/
+	struct result_t
+	{
+		std::string mesh, stage;
+		long num_vertices, num_faces;
+		double min, mean, p50, p90, max;
+		std::size_t peak_memory;
+	};
+
+	// Nearest-rank percentile of sorted samples.
+	double percentile(const std::vector<double>& sorted, double p)
+	{
+		const std::size_t rank = std::size_t(std::ceil(p / 100 * sorted.size()));
+		return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+	}
+
+	result_t summarize(const input_t& input, const char* stage, std::vector<double> samples)
+	{
+		std::sort(samples.begin(), samples.end());
+		result_t result;
+		result.mesh = input.name;
+		result.stage = stage;
+		result.num_vertices = input.num_vertices;
+		result.num_faces = input.triangles.size();
+		result.min = samples.front();
+		result.max = samples.back();
+		result.mean = 0;
+		for (const double s : samples) { result.mean += s / samples.size(); }
+		result.p50 = percentile(samples, 50);
+		result.p90 = percentile(samples, 90);
+		result.peak_memory = peak_memory();
+		return result;
+	}
+
+	/*
+	* Name: run
+	* Func: Time every stage "repetitions" times on the input and append the statistics to results.
+	*/
+	void run(const input_t& input, int repetitions, unsigned num_threads, std::vector<result_t>& results)
+	{
+		const long num_triangles = input.triangles.size();
+		const trimesh::triangle_t* triangles = input.triangles.data();
+		std::vector<double> t_edges, t_build, t_build_from_triangles, t_one_ring, t_adjacency;
+		long checksum = 0;
+
+		for (int r = 0; r < repetitions; ++r) {
+			trimesh::trimesh_t mesh;
+			mesh.set_num_threads(num_threads);
+			std::vector<trimesh::edge_t> edges;
+
+			double start = now();
+			mesh.triangles2edges(num_triangles, triangles, edges);
+			t_edges.push_back(now() - start);
+
+			start = now();
+			mesh.build(input.num_vertices, num_triangles, triangles, edges.size(), edges.data());
+			t_build.push_back(now() - start);
+
+			trimesh::trimesh_t mesh2;
+			mesh2.set_num_threads(num_threads);
+			start = now();
+			mesh2.build_from_triangles(input.num_vertices, num_triangles, triangles);
+			t_build_from_triangles.push_back(now() - start);
+
+			// Full one-ring traversal. The checksum keeps the loop from being optimized away.
+			start = now();
+			for (long v = 0; v < input.num_vertices; ++v) {
+				for (const trimesh::index_t neighbor : mesh2.vv_range(v)) { checksum += neighbor; }
+			}
+			t_one_ring.push_back(now() - start);
+
+			trimesh::csr_t vv, vf;
+			start = now();
+			mesh2.vertex_adjacency(vv, vf);
+			t_adjacency.push_back(now() - start);
+			checksum += vv.indices.size();
+		}
+
+		results.push_back(summarize(input, "triangles2edges", t_edges));
+		results.push_back(summarize(input, "build", t_build));
+		results.push_back(summarize(input, "build_from_triangles", t_build_from_triangles));
+		results.push_back(summarize(input, "one_ring", t_one_ring));
+		results.push_back(summarize(input, "vertex_adjacency", t_adjacency));
+		std::fprintf(stderr, "%s: %ld vertices, %ld faces done (checksum %ld)\n", input.name.c_str(), input.num_vertices, num_triangles, checksum);
+	}
+
+	// The mesh name may be a file path, which needs escaping in JSON.
+	std::string json_escape(const std::string& text)
+	{
+		std::string escaped;
+		for (const char c : text) {
+			if (c == '"' || c == '\\') { escaped += '\\'; }
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	// And quoting in CSV, with embedded quotes doubled, since it may hold commas.
+	std::string csv_escape(const std::string& text)
+	{
+		std::string escaped = "\"";
+		for (const char c : text) {
+			if (c == '"') { escaped += '"'; }
+			escaped += c;
+		}
+		return escaped + '"';
+	}
+
+	void write_json(std::FILE* out, const std::vector<result_t>& results, int repetitions, unsigned num_threads)
+	{
+		std::fprintf(out, "{\n  \"benchmark\": \"trimesh_t\",\n  \"repetitions\": %d,\n  \"threads\": %u,\n  \"results\": [\n", repetitions, num_threads);
+		for (std::size_t i = 0; i < results.size(); ++i) {
+			const result_t& r = results[i];
+			std::fprintf(out,
+				"    {\"mesh\": \"%s\", \"vertices\": %ld, \"faces\": %ld, \"stage\": \"%s\", "
+				"\"min_s\": %.9f, \"mean_s\": %.9f, \"p50_s\": %.9f, \"p90_s\": %.9f, \"max_s\": %.9f, \"process_peak_memory_bytes\": %zu}%s\n",
+				json_escape(r.mesh).c_str(), r.num_vertices, r.num_faces, r.stage.c_str(),
+				r.min, r.mean, r.p50, r.p90, r.max, r.peak_memory, i + 1 < results.size() ? "," : "");
+		}
+		std::fprintf(out, "  ]\n}\n");
+	}
+
+	void write_csv(std::FILE* out, const std::vector<result_t>& results, int repetitions, unsigned num_threads)
+	{
+		std::fprintf(out, "mesh,vertices,faces,stage,repetitions,threads,min_s,mean_s,p50_s,p90_s,max_s,process_peak_memory_bytes\n");
+		for (const result_t& r : results) {
+			std::fprintf(out, "%s,%ld,%ld,%s,%d,%u,%.9f,%.9f,%.9f,%.9f,%.9f,%zu\n",
+				csv_escape(r.mesh).c_str(), r.num_vertices, r.num_faces, r.stage.c_str(), repetitions, num_threads,
+				r.min, r.mean, r.p50, r.p90, r.max, r.peak_memory);
+		}
+	}
+
+	int usage()
+	{
+		std::fprintf(stderr,
+			"Usage: benchmark [--faces 10000,1000000,...] [--mesh file] [--repetitions 5] [--threads 1] [--shuffle]\n"
+			"                 [--format json|csv] [--output file]\n"
+			"process_peak_memory_bytes is the peak of the whole process when the stage ended. Sizes run in increasing order,\n"
+			"so it is the peak of the largest mesh so far.\n");
+		return 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<long> sizes;
+	const char* mesh_file = nullptr;
+	const char* output = nullptr;
+	std::string format = "json";
+	int repetitions = 5;
+	unsigned num_threads = 1;
+	bool shuffle = false;
+
+	for (int i = 1; i < argc; ++i) {
+		const bool has_value = i + 1 < argc;
+		if (!std::strcmp(argv[i], "--faces") && has_value) {
+			for (char* token = std::strtok(argv[++i], ","); token; token = std::strtok(nullptr, ",")) { sizes.push_back(std::atol(token)); }
+		}
+		else if (!std::strcmp(argv[i], "--mesh") && has_value) { mesh_file = argv[++i]; }
+		else if (!std::strcmp(argv[i], "--repetitions") && has_value) { repetitions = std::atoi(argv[++i]); }
+		else if (!std::strcmp(argv[i], "--threads") && has_value) { num_threads = std::atoi(argv[++i]); }
+		else if (!std::strcmp(argv[i], "--format") && has_value) { format = argv[++i]; }
+		else if (!std::strcmp(argv[i], "--output") && has_value) { output = argv[++i]; }
+		else if (!std::strcmp(argv[i], "--shuffle")) { shuffle = true; }
+		else { return usage(); }
+	}
+	if (repetitions < 1 || (format != "json" && format != "csv")) { return usage(); }
+	if (sizes.empty() && !mesh_file) { sizes = { 10000, 100000, 1000000, 10000000, 50000000 }; }
+	std::sort(sizes.begin(), sizes.end());
+
+	std::vector<result_t> results;
+	if (mesh_file) {
+		input_t input;
+		input.name = mesh_file;
+		std::vector<double> positions;
+		if (!trimesh::read_mesh(mesh_file, positions, input.triangles, num_threads)) {
+			std::fprintf(stderr, "Can't read %s\n", mesh_file);
+			return 1;
+		}
+		input.num_vertices = positions.size() / 3;
+		run(input, repetitions, num_threads, results);
+	}
+	for (const long size : sizes) {
+		run(make_grid(size, shuffle), repetitions, num_threads, results);
+	}
+
+	std::FILE* out = output ? std::fopen(output, "w") : stdout;
+	if (!out) {
+		std::fprintf(stderr, "Can't write %s\n", output);
+		return 1;
+	}
+	if (format == "json") { write_json(out, results, repetitions, num_threads); }
+	else { write_csv(out, results, repetitions, num_threads); }
+	if (out != stdout) { std::fclose(out); }
+	return 0;
+}
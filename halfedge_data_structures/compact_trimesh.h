@@ -0,0 +1,142 @@
+#ifndef __compact_trimesh_h__
+#define __compact_trimesh_h__
+
+#include"trimesh.h"
+#include<vector>
+#include<cassert>
+#include<cstdint>
+
+namespace trimesh
+{
+	/*
+	* Name: compact_trimesh_t
+	* Func: Triangle mesh class with a compact halfedge layout, templated on the index type.
+	* The two halfedges of edge[i] are the pair (2 * i, 2 * i + 1), so "opposite" and "edge" are not stored:
+	* opposite(h) = h ^ 1, edge(h) = h >> 1. With uint32_t indices a halfedge takes 12 bytes instead of 40.
+	* @Varia m_halfedges[i]: The halfedge of index i.
+	* @Varia m_vertex_halfedges[i]: The index of one of outgoing halfedges related to vertex[i].
+	* @Varia m_face_halfedges[i]: The index of one of halfedges related to face[i].
+	*/
+	template<typename index_type>
+	class compact_trimesh_t
+	{
+	public:
+		typedef index_type index_t;
+
+		// Replaces -1 of trimesh_t, e.g. 0xffffffff for uint32_t.
+		static constexpr index_t invalid = index_t(-1);
+
+		/*
+		* Name: halfedge_t
+		* Func: Compact halfedge class.
+		* @Varia vertex: The index of vertex pointed by halfedge.
+		* @Varia face: The index of face related to halfedge. "invalid" if halfedge is a boundary halfedge.
+		* @Varia next: The index of next halfedge.
+		*/
+		struct halfedge_t
+		{
+			index_t vertex, face, next;
+		};
+
+	private:
+		std::vector<halfedge_t> m_halfedges;
+		std::vector<index_t> m_vertex_halfedges;
+		std::vector<index_t> m_face_halfedges;
+
+		static index_t convert(trimesh_t::index_t index)
+		{
+			// The index must fit into index_t.
+			assert(index == -1 || (trimesh_t::index_t(index_t(index)) == index && index_t(index) != invalid));
+			return index == -1 ? invalid : index_t(index);
+		}
+
+	public:
+		/*
+		* Name: assign
+		* Func: Copy the connectivity of a built trimesh_t into the compact layout.
+		*/
+		void assign(const trimesh_t& mesh)
+		{
+			m_halfedges.resize(mesh.num_halfedges());
+			for (trimesh_t::index_t i = 0; i < mesh.num_halfedges(); ++i) {
+				const trimesh_t::halfedge_t& he = mesh.halfedge(i);
+				assert(he.opposite == (i ^ 1) && he.edge == (i >> 1));
+				m_halfedges[i].vertex = convert(he.vertex);
+				m_halfedges[i].face = convert(he.face);
+				m_halfedges[i].next = convert(he.next);
+			}
+
+			m_vertex_halfedges.resize(mesh.num_vertices());
+			for (trimesh_t::index_t i = 0; i < mesh.num_vertices(); ++i) {
+				m_vertex_halfedges[i] = convert(mesh.vertex_halfedge(i));
+			}
+
+			m_face_halfedges.resize(mesh.num_faces());
+			for (trimesh_t::index_t i = 0; i < mesh.num_faces(); ++i) {
+				m_face_halfedges[i] = convert(mesh.face_halfedge(i));
+			}
+		}
+
+		/*
+		* Name: clear
+		* Func: Clear all the member variables in the triangle mesh.
+		*/
+		void clear()
+		{
+			m_halfedges.clear();
+			m_vertex_halfedges.clear();
+			m_face_halfedges.clear();
+		}
+
+		/*
+		* Name: num_vertices/num_faces/num_edges/num_halfedges
+		* Func: Return the number of elements in the mesh.
+		*/
+		std::size_t num_vertices() const { return m_vertex_halfedges.size(); }
+		std::size_t num_faces() const { return m_face_halfedges.size(); }
+		std::size_t num_edges() const { return m_halfedges.size() / 2; }
+		std::size_t num_halfedges() const { return m_halfedges.size(); }
+
+		/*
+		* Name: vertex/face/next/opposite/edge
+		* Func: Query the halfedge of index "he_index". "opposite" and "edge" are computed from the index.
+		*/
+		index_t vertex(const index_t he_index) const { return m_halfedges[he_index].vertex; }
+		index_t face(const index_t he_index) const { return m_halfedges[he_index].face; }
+		index_t next(const index_t he_index) const { return m_halfedges[he_index].next; }
+		static index_t opposite(const index_t he_index) { return he_index ^ 1; }
+		static index_t edge(const index_t he_index) { return he_index >> 1; }
+
+		/*
+		* Name: vertex_halfedge/face_halfedge/edge_halfedge
+		* Func: Return one of the halfedges related to the vertex/face/edge.
+		*/
+		index_t vertex_halfedge(const index_t index) const { return m_vertex_halfedges[index]; }
+		index_t face_halfedge(const index_t index) const { return m_face_halfedges[index]; }
+		static index_t edge_halfedge(const index_t index) { return index << 1; }
+
+		/*
+		* Name: vv_neighbors
+		* Func: Record the indices of one-ring neighbors of vertex[index] into neighbors vector. None for an isolated vertex.
+		*/
+		void vv_neighbors(const index_t index, std::vector<index_t>& neighbors) const
+		{
+			neighbors.clear();
+			index_t he_index = m_vertex_halfedges[index];
+			if (he_index == invalid) { return; }
+			const index_t hstop = he_index;
+			do {
+				neighbors.push_back(m_halfedges[he_index].vertex);
+				he_index = m_halfedges[opposite(he_index)].next;
+			} while (he_index != hstop);
+		}
+	};
+
+	template<typename index_type>
+	constexpr typename compact_trimesh_t<index_type>::index_t compact_trimesh_t<index_type>::invalid;
+
+	typedef compact_trimesh_t<std::uint32_t> compact_trimesh32_t;
+	typedef compact_trimesh_t<std::int64_t> compact_trimesh64_t;
+}
+
+#endif // !__compact_trimesh_h__
@@ -0,0 +1,385 @@
+#include"decimate.h"
+#include"parallel.h"
+#include<cmath>
+#include<cassert>
+
+namespace trimesh
+{
+	namespace
+	{
+		struct vec3_t
+		{
+			double x, y, z;
+		};
+
+		vec3_t operator+(const vec3_t& a, const vec3_t& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+		vec3_t operator-(const vec3_t& a, const vec3_t& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		vec3_t operator*(double s, const vec3_t& a) { return { s * a.x, s * a.y, s * a.z }; }
+		double dot(const vec3_t& a, const vec3_t& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		vec3_t cross(const vec3_t& a, const vec3_t& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+		/*
+		* Name: quadric_t
+		* Func: Symmetric 4x4 matrix Q such that v^T Q v is the sum of squared distances from v = (x, y, z, 1) to a set of planes.
+		* @Varia a: The upper triangle of Q, row by row: q00 q01 q02 q03 q11 q12 q13 q22 q23 q33.
+		*/
+		struct quadric_t
+		{
+			double a[10];
+
+			quadric_t() { for (double& x : a) { x = 0; } }
+
+			// The plane n . p + d = 0 with unit normal n, scaled by weight.
+			quadric_t(const vec3_t& n, double d, double weight)
+			{
+				const double p[4] = { n.x, n.y, n.z, d };
+				int k = 0;
+				for (int i = 0; i < 4; ++i) {
+					for (int j = i; j < 4; ++j) { a[k++] = weight * p[i] * p[j]; }
+				}
+			}
+
+			quadric_t& operator+=(const quadric_t& other)
+			{
+				for (int i = 0; i < 10; ++i) { a[i] += other.a[i]; }
+				return *this;
+			}
+
+			double error(const vec3_t& p) const
+			{
+				return a[0] * p.x * p.x + 2 * a[1] * p.x * p.y + 2 * a[2] * p.x * p.z + 2 * a[3] * p.x
+					+ a[4] * p.y * p.y + 2 * a[5] * p.y * p.z + 2 * a[6] * p.y
+					+ a[7] * p.z * p.z + 2 * a[8] * p.z
+					+ a[9];
+			}
+
+			/*
+			* Name: minimize
+			* Func: Solve grad(v^T Q v) = 0 for the position of least error. Return false if the system is near singular.
+			*/
+			bool minimize(vec3_t& p) const
+			{
+				const double m00 = a[0], m01 = a[1], m02 = a[2], m11 = a[4], m12 = a[5], m22 = a[7];
+				const double c00 = m11 * m22 - m12 * m12;
+				const double c01 = m02 * m12 - m01 * m22;
+				const double c02 = m01 * m12 - m02 * m11;
+				const double det = m00 * c00 + m01 * c01 + m02 * c02;
+				const double scale = m00 * m00 + m11 * m11 + m22 * m22;
+				if (!(std::fabs(det) > 1e-12 * scale * std::sqrt(scale))) { return false; }
+
+				const double c11 = m00 * m22 - m02 * m02;
+				const double c12 = m01 * m02 - m00 * m12;
+				const double c22 = m00 * m11 - m01 * m01;
+				const vec3_t b = { -a[3], -a[6], -a[8] };
+				p.x = (c00 * b.x + c01 * b.y + c02 * b.z) / det;
+				p.y = (c01 * b.x + c11 * b.y + c12 * b.z) / det;
+				p.z = (c02 * b.x + c12 * b.y + c22 * b.z) / det;
+				return true;
+			}
+		};
+
+		/*
+		* Name: cost_t
+		* Func: The cost of an edge collapse. Ties in the quadric error, e.g. 0 on flat regions, go to the shorter edge,
+		* which keeps the collapses spread out instead of piling the edges onto a few vertices of high valence.
+		*/
+		struct cost_t
+		{
+			double error, length2;
+
+			bool operator<(const cost_t& other) const { return error < other.error || (error == other.error && length2 < other.length2); }
+			bool operator==(const cost_t& other) const { return error == other.error && length2 == other.length2; }
+		};
+
+		/*
+		* Name: edge_heap_t
+		* Func: Binary min-heap of edges keyed by collapse cost, indexed by edge so that a cost can be updated or removed in O(log n).
+		* @Varia m_heap: The edges in heap order.
+		* @Varia m_position[e]: The position of edge[e] in m_heap, -1 if it's not in the heap.
+		* @Varia m_cost[e]: The collapse cost of edge[e].
+		*/
+		class edge_heap_t
+		{
+		private:
+			std::vector<index_t> m_heap;
+			std::vector<index_t> m_position;
+			const std::vector<cost_t>& m_cost;
+
+			bool less(index_t i, index_t j) const
+			{
+				const index_t a = m_heap[i], b = m_heap[j];
+				return m_cost[a] < m_cost[b] || (m_cost[a] == m_cost[b] && a < b);
+			}
+
+			void place(index_t i, index_t edge)
+			{
+				m_heap[i] = edge;
+				m_position[edge] = i;
+			}
+
+			void swap(index_t i, index_t j)
+			{
+				const index_t edge = m_heap[i];
+				place(i, m_heap[j]);
+				place(j, edge);
+			}
+
+			void up(index_t i)
+			{
+				while (i > 0 && less(i, (i - 1) / 2)) {
+					swap(i, (i - 1) / 2);
+					i = (i - 1) / 2;
+				}
+			}
+
+			void down(index_t i)
+			{
+				const index_t n = m_heap.size();
+				for (;;) {
+					index_t smallest = i;
+					if (2 * i + 1 < n && less(2 * i + 1, smallest)) { smallest = 2 * i + 1; }
+					if (2 * i + 2 < n && less(2 * i + 2, smallest)) { smallest = 2 * i + 2; }
+					if (smallest == i) { return; }
+					swap(i, smallest);
+					i = smallest;
+				}
+			}
+
+		public:
+			edge_heap_t(const std::vector<cost_t>& cost) : m_position(cost.size(), -1), m_cost(cost) {}
+
+			bool empty() const { return m_heap.empty(); }
+			index_t top() const { return m_heap[0]; }
+
+			// Build the heap from all the edges with a finite cost in O(n).
+			void assign()
+			{
+				m_heap.clear();
+				for (std::size_t e = 0; e < m_cost.size(); ++e) {
+					if (std::isfinite(m_cost[e].error)) {
+						m_position[e] = m_heap.size();
+						m_heap.push_back(e);
+					}
+				}
+				for (index_t i = index_t(m_heap.size()) / 2 - 1; i >= 0; --i) { down(i); }
+			}
+
+			void remove(index_t edge)
+			{
+				const index_t i = m_position[edge];
+				if (i == -1) { return; }
+				m_position[edge] = -1;
+				const index_t last = m_heap.back();
+				m_heap.pop_back();
+				if (last == edge) { return; }
+				place(i, last);
+				up(i);
+				down(m_position[last]);
+			}
+
+			// Insert the edge, or move it after its cost changed. Edges with an infinite cost are removed.
+			void update(index_t edge)
+			{
+				if (!std::isfinite(m_cost[edge].error)) { remove(edge); return; }
+				index_t i = m_position[edge];
+				if (i == -1) {
+					i = m_heap.size();
+					m_heap.push_back(edge);
+					m_position[edge] = i;
+				}
+				up(i);
+				down(m_position[edge]);
+			}
+		};
+
+		/*
+		* Name: decimater_t
+		* Func: The state of one call to "decimate".
+		* @Varia m_quadrics[v]: The quadric of vertex[v], accumulated over the collapses.
+		* @Varia m_cost[e]/m_target[e]: The cost of collapsing edge[e] and the position of the merged vertex.
+		*/
+		class decimater_t
+		{
+		private:
+			trimesh_t& m_mesh;
+			std::vector<double>& m_positions;
+			std::vector<quadric_t> m_quadrics;
+			std::vector<cost_t> m_cost;
+			std::vector<vec3_t> m_target;
+
+			vec3_t position(index_t vertex) const
+			{
+				const double* p = &m_positions[3 * vertex];
+				return { p[0], p[1], p[2] };
+			}
+
+			index_t from(index_t he_index) const { return m_mesh.halfedge(m_mesh.halfedge(he_index).opposite).vertex; }
+			index_t to(index_t he_index) const { return m_mesh.halfedge(he_index).vertex; }
+
+			vec3_t face_normal(index_t face) const
+			{
+				const index_t h = m_mesh.face_halfedge(face);
+				const vec3_t p0 = position(from(h)), p1 = position(to(h)), p2 = position(to(m_mesh.halfedge(h).next));
+				return cross(p1 - p0, p2 - p0);
+			}
+
+		public:
+			decimater_t(trimesh_t& mesh, std::vector<double>& positions) : m_mesh(mesh), m_positions(positions) {}
+
+			/*
+			* Name: init_quadrics
+			* Func: Sum the area-weighted planes of the faces around each vertex, plus the planes through the boundary edges
+			* perpendicular to their face, weighted by the squared edge length.
+			*/
+			void init_quadrics()
+			{
+				const double boundary_weight = 1000.0;
+				m_quadrics.assign(m_mesh.num_vertices(), quadric_t());
+				parallel_for(0, m_mesh.num_vertices(), m_mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+					for (std::size_t v = begin; v < end; ++v) {
+						if (m_mesh.is_vertex_deleted(v)) { continue; }
+						quadric_t& q = m_quadrics[v];
+						const vec3_t pv = position(v);
+						for (const index_t he_index : m_mesh.voh_range(v)) {
+							const trimesh_t::halfedge_t& he = m_mesh.halfedge(he_index);
+							if (he.face != -1) {
+								const vec3_t n = face_normal(he.face);
+								const double length = std::sqrt(dot(n, n));
+								if (length > 0) { q += quadric_t((1 / length) * n, -dot(n, pv) / length, 0.5 * length); }
+							}
+
+							// The boundary edges starting or ending at v.
+							const index_t sides[2] = { he_index, he.opposite };
+							for (const index_t side : sides) {
+								if (m_mesh.halfedge(side).face != -1 || m_mesh.halfedge(m_mesh.halfedge(side).opposite).face == -1) { continue; }
+								const vec3_t d = position(to(side)) - position(from(side));
+								const vec3_t n = cross(d, face_normal(m_mesh.halfedge(m_mesh.halfedge(side).opposite).face));
+								const double length = std::sqrt(dot(n, n));
+								if (length > 0) { q += quadric_t((1 / length) * n, -dot(n, pv) / length, boundary_weight * dot(d, d)); }
+							}
+						}
+					}
+				});
+			}
+
+			/*
+			* Name: evaluate
+			* Func: Update the cost and the target position of edge[index].
+			*/
+			void evaluate(index_t index)
+			{
+				const index_t h = m_mesh.edge_halfedge(index);
+				const index_t v0 = from(h), v1 = to(h);
+				quadric_t q = m_quadrics[v0];
+				q += m_quadrics[v1];
+
+				vec3_t p;
+				if (!q.minimize(p)) {
+					// Fall back to the best of the two ends and the midpoint.
+					const vec3_t candidates[3] = { position(v0), position(v1), 0.5 * (position(v0) + position(v1)) };
+					p = candidates[0];
+					for (const vec3_t& c : candidates) {
+						if (q.error(c) < q.error(p)) { p = c; }
+					}
+				}
+				m_target[index] = p;
+				const vec3_t d = position(v1) - position(v0);
+				m_cost[index].error = std::fmax(q.error(p), 0.0);
+				m_cost[index].length2 = dot(d, d);
+			}
+
+			/*
+			* Name: flips_face
+			* Func: Return true if moving vertex[vertex] to p turns the normal of a face around it by more than 60 degrees,
+			* ignoring the faces removed by collapsing halfedge[collapsed]. Small turns add up over the collapses, hence the margin.
+			*/
+			bool flips_face(index_t vertex, index_t collapsed, const vec3_t& p) const
+			{
+				const index_t f0 = m_mesh.halfedge(collapsed).face;
+				const index_t f1 = m_mesh.halfedge(m_mesh.halfedge(collapsed).opposite).face;
+				for (const index_t he_index : m_mesh.voh_range(vertex)) {
+					const trimesh_t::halfedge_t& he = m_mesh.halfedge(he_index);
+					if (he.face == -1 || he.face == f0 || he.face == f1) { continue; }
+					const vec3_t p1 = position(he.vertex), p2 = position(to(he.next));
+					const vec3_t before = cross(p1 - position(vertex), p2 - position(vertex));
+					const vec3_t after = cross(p1 - p, p2 - p);
+					if (dot(before, after) <= 0.5 * std::sqrt(dot(before, before) * dot(after, after))) { return true; }
+				}
+				return false;
+			}
+
+			index_t run(index_t target_faces, double max_error)
+			{
+				index_t num_faces = 0;
+				for (index_t f = 0; f < m_mesh.num_faces(); ++f) { num_faces += !m_mesh.is_face_deleted(f); }
+
+				init_quadrics();
+				m_cost.assign(m_mesh.num_edges(), cost_t{ INFINITY, 0 });
+				m_target.resize(m_mesh.num_edges());
+				parallel_for(0, m_mesh.num_edges(), m_mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+					for (std::size_t e = begin; e < end; ++e) {
+						if (!m_mesh.is_edge_deleted(e)) { evaluate(e); }
+					}
+				});
+
+				edge_heap_t heap(m_cost);
+				heap.assign();
+				std::vector<index_t> ring;
+				while (num_faces > target_faces && !heap.empty()) {
+					const index_t e = heap.top();
+					if (m_cost[e].error > max_error) { break; }
+
+					// Either direction gives the same connectivity. The surviving vertex moves to the target position.
+					const vec3_t p = m_target[e];
+					index_t h = m_mesh.edge_halfedge(e);
+					if (!m_mesh.is_collapse_ok(h)) { h = m_mesh.halfedge(h).opposite; }
+					if (!m_mesh.is_collapse_ok(h) || flips_face(from(h), h, p) || flips_face(to(h), h, p)) {
+						// Retried when a neighboring collapse changes the edge.
+						m_cost[e].error = INFINITY;
+						heap.remove(e);
+						continue;
+					}
+
+					const index_t v0 = from(h), v1 = to(h);
+					num_faces -= (m_mesh.halfedge(h).face != -1) + (m_mesh.halfedge(m_mesh.halfedge(h).opposite).face != -1);
+					ring.clear();
+					for (const index_t edge : m_mesh.ve_range(v0)) { ring.push_back(edge); }
+
+					m_mesh.collapse(h);
+					m_quadrics[v1] += m_quadrics[v0];
+					m_positions[3 * v1 + 0] = p.x;
+					m_positions[3 * v1 + 1] = p.y;
+					m_positions[3 * v1 + 2] = p.z;
+
+					// The removed edges all touched v0, and the edges left around v1 have a new cost.
+					for (const index_t edge : ring) {
+						if (m_mesh.is_edge_deleted(edge)) { heap.remove(edge); }
+					}
+					for (const index_t edge : m_mesh.ve_range(v1)) {
+						evaluate(edge);
+						heap.update(edge);
+					}
+				}
+				return num_faces;
+			}
+		};
+	}
+
+	index_t decimate(trimesh_t& mesh, std::vector<double>& positions, index_t target_faces, double max_error, permutation_t& permutation)
+	{
+		assert(positions.size() == 3 * std::size_t(mesh.num_vertices()));
+
+		decimater_t decimater(mesh, positions);
+		const index_t num_faces = decimater.run(target_faces, max_error);
+
+		mesh.garbage_collect(permutation);
+		std::vector<double> compacted(3 * mesh.num_vertices());
+		for (std::size_t v = 0; v < permutation.vertices.size(); ++v) {
+			const index_t i = permutation.vertices[v];
+			if (i == -1) { continue; }
+			for (int k = 0; k < 3; ++k) { compacted[3 * i + k] = positions[3 * v + k]; }
+		}
+		positions.swap(compacted);
+		return num_faces;
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef __decimate_h__
+#define __decimate_h__
+
+#include"trimesh.h"
+#include<vector>
+
+namespace trimesh
+{
+	/*
+	* Name: decimate
+	* Func: Simplify the mesh by quadric error metric edge collapses (Garland and Heckbert 1997), cheapest collapse first.
+	* Stop when at most "target_faces" faces are left, or when the cheapest collapse costs more than "max_error",
+	* the sum of squared distances from the new vertex to the planes of the original triangles around it.
+	* Collapses that break the link condition or fold a triangle over are skipped. Boundary edges are kept in place by extra quadrics.
+	* positions (x0, y0, z0, x1, y1, z1, ...) follow the vertices. At the end the deleted elements are removed by "garbage_collect",
+	* and permutation records old -> new indices for the other attributes. Return the number of faces left.
+	*/
+	index_t decimate(trimesh_t& mesh, std::vector<double>& positions, index_t target_faces, double max_error, permutation_t& permutation);
+}
+
+#endif // !__decimate_h__
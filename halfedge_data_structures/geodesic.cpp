@@ -0,0 +1,148 @@
+#include"geodesic.h"
+#include"parallel.h"
+#include<cmath>
+#include<cstring>
+#include<cassert>
+#include<algorithm>
+
+#ifdef _MSC_VER
+#include<intrin.h>
+#endif
+
+namespace trimesh
+{
+	std::uint64_t radix_heap_t::bits(double key)
+	{
+		std::uint64_t bits;
+		std::memcpy(&bits, &key, sizeof(bits));
+		return bits;
+	}
+
+	double radix_heap_t::from_bits(std::uint64_t bits)
+	{
+		double key;
+		std::memcpy(&key, &bits, sizeof(key));
+		return key;
+	}
+
+	int radix_heap_t::bucket(std::uint64_t key) const
+	{
+		const std::uint64_t diff = key ^ m_last;
+		if (diff == 0) { return 0; }
+#ifdef _MSC_VER
+		unsigned long bit;
+		_BitScanReverse64(&bit, diff);
+		return int(bit) + 1;
+#else
+		return 64 - __builtin_clzll(diff);
+#endif
+	}
+
+	void radix_heap_t::clear()
+	{
+		for (std::vector<entry_t>& bucket : m_buckets) { bucket.clear(); }
+		m_last = 0;
+		m_size = 0;
+	}
+
+	void radix_heap_t::push(double key, index_t vertex)
+	{
+		assert(key >= 0 && bits(key) >= m_last);
+		entry_t entry;
+		entry.key = bits(key);
+		entry.vertex = vertex;
+		m_buckets[bucket(entry.key)].push_back(entry);
+		++m_size;
+	}
+
+	double radix_heap_t::pop(index_t& vertex)
+	{
+		assert(m_size > 0);
+		if (m_buckets[0].empty()) {
+			// Move the smallest key of the first non-empty bucket to m_last: its entries all go to smaller buckets.
+			int b = 1;
+			while (m_buckets[b].empty()) { ++b; }
+			std::vector<entry_t>& from = m_buckets[b];
+			std::uint64_t smallest = from[0].key;
+			for (const entry_t& entry : from) { smallest = std::min(smallest, entry.key); }
+			m_last = smallest;
+			for (const entry_t& entry : from) { m_buckets[bucket(entry.key)].push_back(entry); }
+			from.clear();
+		}
+		vertex = m_buckets[0].back().vertex;
+		m_buckets[0].pop_back();
+		--m_size;
+		return from_bits(m_last);
+	}
+
+	template<typename scalar_t>
+	void geodesic_dijkstra_t::build(const trimesh_t& mesh, const soa3_t<scalar_t>& positions)
+	{
+		assert(positions.size() == std::size_t(mesh.num_vertices()));
+		m_mesh = &mesh;
+		m_edge_lengths.resize(mesh.num_edges());
+		parallel_for(0, mesh.num_edges(), mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t e = begin; e < end; ++e) {
+				const index_t h = mesh.edge_halfedge(e);
+				const index_t i = mesh.halfedge(mesh.halfedge(h).opposite).vertex, j = mesh.halfedge(h).vertex;
+				const double x = double(positions.x[i]) - positions.x[j];
+				const double y = double(positions.y[i]) - positions.y[j];
+				const double z = double(positions.z[i]) - positions.z[j];
+				m_edge_lengths[e] = std::sqrt(x * x + y * y + z * z);
+			}
+		});
+		m_distances.assign(mesh.num_vertices(), std::numeric_limits<double>::infinity());
+		m_reached.clear();
+		m_heap.clear();
+	}
+
+	void geodesic_dijkstra_t::run(const index_t* sources, std::size_t num_sources, double max_distance)
+	{
+		assert(m_mesh);
+		for (const index_t v : m_reached) { m_distances[v] = std::numeric_limits<double>::infinity(); }
+		m_reached.clear();
+		m_heap.clear();
+
+		for (std::size_t i = 0; i < num_sources; ++i) {
+			assert(sources[i] >= 0 && sources[i] < m_mesh->num_vertices());
+			if (m_distances[sources[i]] == 0) { continue; }
+			m_distances[sources[i]] = 0;
+			m_heap.push(0, sources[i]);
+		}
+
+		const trimesh_t& mesh = *m_mesh;
+		while (!m_heap.empty()) {
+			index_t v;
+			const double distance = m_heap.pop(v);
+			// Stale entry: v was reached again by a shorter path after this entry was pushed.
+			if (distance > m_distances[v]) { continue; }
+			m_reached.push_back(v);
+
+			for (const index_t he_index : mesh.voh_range(v)) {
+				const trimesh_t::halfedge_t& he = mesh.halfedge(he_index);
+				const double candidate = distance + m_edge_lengths[he.edge];
+				if (candidate < m_distances[he.vertex] && candidate <= max_distance) {
+					m_distances[he.vertex] = candidate;
+					m_heap.push(candidate, he.vertex);
+				}
+			}
+		}
+	}
+
+	void geodesic_dijkstra_t::distances(const std::vector<index_t>& sources, std::vector<double>& distances, double max_distance)
+	{
+		run(sources.data(), sources.size(), max_distance);
+		distances = m_distances;
+	}
+
+	void geodesic_dijkstra_t::within(const std::vector<index_t>& sources, double max_distance, std::vector<index_t>& vertices, std::vector<double>& distances)
+	{
+		run(sources.data(), sources.size(), max_distance);
+		vertices = m_reached;
+		distances.resize(m_reached.size());
+		for (std::size_t i = 0; i < m_reached.size(); ++i) { distances[i] = m_distances[m_reached[i]]; }
+	}
+
+	template void geodesic_dijkstra_t::build<float>(const trimesh_t&, const soa3_t<float>&);
+	template void geodesic_dijkstra_t::build<double>(const trimesh_t&, const soa3_t<double>&);
+}
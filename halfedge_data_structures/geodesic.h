@@ -0,0 +1,99 @@
+#ifndef __geodesic_h__
+#define __geodesic_h__
+
+#include"trimesh.h"
+#include"mesh_properties.h"
+#include<vector>
+#include<limits>
+#include<cstdint>
+
+namespace trimesh
+{
+	/*
+	* Name: radix_heap_t
+	* Func: Monotone min-priority queue of (distance, vertex) for Dijkstra: a pushed key must not be smaller than the last popped key.
+	* Keys are non-negative doubles, compared through their IEEE bits. Entry i goes to the bucket of the highest bit where it differs
+	* from the last popped key, so each entry moves down at most 64 times. "clear" keeps the memory of the buckets for the next run.
+	* @Varia m_buckets[b]: Entries whose key differs from m_last first at bit b - 1. Bucket 0 holds the keys equal to m_last.
+	* @Varia m_last: The bits of the last popped key.
+	*/
+	class radix_heap_t
+	{
+	public:
+		struct entry_t
+		{
+			std::uint64_t key;
+			index_t vertex;
+		};
+
+	private:
+		std::vector<entry_t> m_buckets[65];
+		std::uint64_t m_last = 0;
+		std::size_t m_size = 0;
+
+		static std::uint64_t bits(double key);
+		static double from_bits(std::uint64_t bits);
+		int bucket(std::uint64_t key) const;
+
+	public:
+		bool empty() const { return m_size == 0; }
+		std::size_t size() const { return m_size; }
+		void clear();
+		void push(double key, index_t vertex);
+
+		/*
+		* Name: pop
+		* Func: Remove an entry with the smallest key, and return its key and vertex.
+		*/
+		double pop(index_t& vertex);
+	};
+
+	/*
+	* Name: geodesic_dijkstra_t
+	* Func: Approximate geodesic distances as shortest paths along the edges, from any set of source vertices.
+	* "build" measures the edges once, then each query runs Dijkstra over the halfedge circulators with a radix heap.
+	* The distances and the heap are kept between queries, so that a query allocates nothing once the buffers have grown
+	* and only resets the vertices it reached. One object runs one query at a time: use one per thread.
+	* @Varia m_edge_lengths[e]: The length of edge[e].
+	* @Varia m_distances[v]: The distance of vertex[v] in the last query, infinity if it wasn't reached.
+	* @Varia m_reached: The vertices reached by the last query, in the order they were settled.
+	*/
+	class geodesic_dijkstra_t
+	{
+	private:
+		const trimesh_t* m_mesh = nullptr;
+		std::vector<double> m_edge_lengths;
+		std::vector<double> m_distances;
+		std::vector<index_t> m_reached;
+		radix_heap_t m_heap;
+
+		void run(const index_t* sources, std::size_t num_sources, double max_distance);
+
+	public:
+		/*
+		* Name: build
+		* Func: Measure the edges of the mesh, on its threads. The mesh must stay alive and unchanged while the object is used.
+		* Instantiated for float and double positions.
+		*/
+		template<typename scalar_t>
+		void build(const trimesh_t& mesh, const soa3_t<scalar_t>& positions);
+
+		const std::vector<double>& edge_lengths() const { return m_edge_lengths; }
+
+		/*
+		* Name: distances
+		* Func: Fill "distances" with the distance of every vertex to the nearest source.
+		* Vertices farther than "max_distance", or not connected to a source, get infinity.
+		*/
+		void distances(const std::vector<index_t>& sources, std::vector<double>& distances, double max_distance = std::numeric_limits<double>::infinity());
+
+		/*
+		* Name: within
+		* Func: Find the vertices at most "max_distance" from the nearest source, nearest first, with their distances.
+		* Only touches the reached vertices, so a small radius costs little on a large mesh.
+		*/
+		void within(const std::vector<index_t>& sources, double max_distance, std::vector<index_t>& vertices, std::vector<double>& distances);
+	};
+}
+
+#endif // !__geodesic_h__
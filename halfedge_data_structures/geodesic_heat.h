@@ -0,0 +1,202 @@
+#ifndef __geodesic_heat_h__
+#define __geodesic_heat_h__
+
+#include"mesh_laplacian_eigen.h"
+#include"parallel.h"
+#include<Eigen/SparseCholesky>
+#include<cmath>
+#include<limits>
+#include<vector>
+
+namespace trimesh
+{
+	/*
+	* Name: geodesic_heat_t
+	* Func: Geodesic distances by the heat method (Crane et al. 2013): diffuse heat from the sources for a short time,
+	* normalize its gradient, and recover the distance whose gradient best fits it with a Poisson equation.
+	* "build" assembles the cotangent Laplacian L and the lumped mass M and factors (M - t L) and -L once,
+	* so that each query is two back-substitutions and two sweeps over the mesh. The buffers are kept between queries.
+	* The boundary has Neumann conditions. Vertices without faces get infinity.
+	* One object runs one query at a time: use one per thread, or copy it after "build".
+	* @Varia m_gradients[h]: For halfedge h of face f, (N x e) / 2A, where e is the vector of h, N and A the normal and area of f.
+	* The gradient over f of a function u is the sum over the halfedges h of f of u(opposite vertex of h) * m_gradients[h].
+	* @Varia m_cotangents[h]: The cotangent of the angle opposite halfedge h in its face, 0 on the boundary.
+	* @Varia m_positions: The positions, for the edge vectors of the divergence.
+	* @Varia m_field: The normalized gradient of the heat on each face, during a query.
+	*/
+	class geodesic_heat_t
+	{
+	public:
+		typedef Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver_t;
+
+	private:
+		const trimesh_t* m_mesh = nullptr;
+		soa3_t<double> m_positions;
+		soa3_t<double> m_gradients;
+		std::vector<double> m_cotangents;
+		std::vector<char> m_isolated;
+		solver_t m_heat_solver;
+		solver_t m_poisson_solver;
+		soa3_t<double> m_field;
+		Eigen::VectorXd m_heat_source, m_heat, m_divergence, m_distance;
+
+		/*
+		* Name: shifted
+		* Func: "matrix" with 1 on the diagonal of the isolated vertices, whose rows are empty, so that it can be factored.
+		*/
+		Eigen::SparseMatrix<double> shifted(const csr_matrix_t& matrix) const
+		{
+			Eigen::SparseMatrix<double> result = to_eigen(matrix);
+			for (std::size_t v = 0; v < m_isolated.size(); ++v) {
+				if (m_isolated[v]) { result.coeffRef(v, v) = 1; }
+			}
+			result.makeCompressed();
+			return result;
+		}
+
+	public:
+		/*
+		* Name: build
+		* Func: Precompute the operators of the mesh and factor the two systems. The mesh must stay alive and unchanged,
+		* and have no deleted elements. The time step is time_factor * h^2, where h is the mean edge length.
+		* Return false if a factorization failed.
+		*/
+		template<typename scalar_t>
+		bool build(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, double time_factor = 1)
+		{
+			m_mesh = &mesh;
+			const std::size_t num_vertices = mesh.num_vertices(), num_halfedges = mesh.num_halfedges();
+			m_positions.resize(num_vertices);
+			for (std::size_t v = 0; v < num_vertices; ++v) {
+				m_positions.x[v] = positions.x[v];
+				m_positions.y[v] = positions.y[v];
+				m_positions.z[v] = positions.z[v];
+			}
+
+			m_gradients.resize(num_halfedges);
+			m_cotangents.assign(num_halfedges, 0);
+			parallel_for(0, mesh.num_faces(), mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+				for (std::size_t f = begin; f < end; ++f) {
+					index_t h[3];
+					h[0] = mesh.face_halfedge(f);
+					h[1] = mesh.halfedge(h[0]).next;
+					h[2] = mesh.halfedge(h[1]).next;
+					// The edge vectors: e[i] goes along h[i], ending at its vertex.
+					double e[3][3];
+					for (int i = 0; i < 3; ++i) {
+						const index_t a = mesh.halfedge(h[(i + 2) % 3]).vertex, b = mesh.halfedge(h[i]).vertex;
+						e[i][0] = m_positions.x[b] - m_positions.x[a];
+						e[i][1] = m_positions.y[b] - m_positions.y[a];
+						e[i][2] = m_positions.z[b] - m_positions.z[a];
+					}
+					// n = e0 x e1 = 2A N.
+					const double nx = e[0][1] * e[1][2] - e[0][2] * e[1][1];
+					const double ny = e[0][2] * e[1][0] - e[0][0] * e[1][2];
+					const double nz = e[0][0] * e[1][1] - e[0][1] * e[1][0];
+					const double double_area2 = nx * nx + ny * ny + nz * nz;
+					const double double_area = std::sqrt(double_area2);
+					for (int i = 0; i < 3; ++i) {
+						// (N x e) / 2A = (n x e) / |n|^2. Zero for a degenerate face.
+						const double scale = double_area2 > 0 ? 1 / double_area2 : 0;
+						m_gradients.x[h[i]] = (ny * e[i][2] - nz * e[i][1]) * scale;
+						m_gradients.y[h[i]] = (nz * e[i][0] - nx * e[i][2]) * scale;
+						m_gradients.z[h[i]] = (nx * e[i][1] - ny * e[i][0]) * scale;
+						// The angle opposite h[i] is between the two other sides: cot = -(e_j . e_k) / |e_j x e_k|, and |e_j x e_k| = 2A.
+						const double* ej = e[(i + 1) % 3];
+						const double* ek = e[(i + 2) % 3];
+						m_cotangents[h[i]] = double_area > 0 ? -(ej[0] * ek[0] + ej[1] * ek[1] + ej[2] * ek[2]) / double_area : 0;
+					}
+				}
+			});
+
+			double total_length = 0;
+			for (index_t e = 0; e < mesh.num_edges(); ++e) {
+				const index_t h = mesh.edge_halfedge(e);
+				const index_t a = mesh.halfedge(mesh.halfedge(h).opposite).vertex, b = mesh.halfedge(h).vertex;
+				const double x = m_positions.x[b] - m_positions.x[a], y = m_positions.y[b] - m_positions.y[a], z = m_positions.z[b] - m_positions.z[a];
+				total_length += std::sqrt(x * x + y * y + z * z);
+			}
+			const double mean_length = mesh.num_edges() > 0 ? total_length / mesh.num_edges() : 0;
+			const double time = time_factor * mean_length * mean_length;
+
+			m_isolated.assign(num_vertices, 0);
+			for (std::size_t v = 0; v < num_vertices; ++v) { m_isolated[v] = mesh.vertex_halfedge(v) == -1; }
+
+			csr_matrix_t laplacian, mass;
+			cotangent_laplacian(mesh, m_positions, laplacian);
+			mass_matrix(mesh, m_positions, MASS_BARYCENTRIC, mass);
+			const Eigen::SparseMatrix<double> L = shifted(laplacian), M = shifted(mass);
+			// -L is only semi-definite: the small multiple of M removes the constants from its kernel.
+			m_heat_solver.compute(M - time * L);
+			m_poisson_solver.compute(1e-8 * M - L);
+
+			m_field.resize(mesh.num_faces());
+			m_heat_source.setZero(num_vertices);
+			m_heat.resize(num_vertices);
+			m_divergence.resize(num_vertices);
+			m_distance.resize(num_vertices);
+			return m_heat_solver.info() == Eigen::Success && m_poisson_solver.info() == Eigen::Success;
+		}
+
+		/*
+		* Name: distances
+		* Func: Fill "distances" with the distance of every vertex to the nearest source.
+		* The distance is shifted to be 0 on average at the sources.
+		*/
+		void distances(const std::vector<index_t>& sources, std::vector<double>& distances)
+		{
+			const trimesh_t& mesh = *m_mesh;
+			const std::size_t num_vertices = mesh.num_vertices();
+			for (const index_t s : sources) { m_heat_source[s] = 1; }
+			m_heat = m_heat_solver.solve(m_heat_source);
+			for (const index_t s : sources) { m_heat_source[s] = 0; }
+
+			// The normalized gradient of the heat, pointing away from the sources.
+			parallel_for(0, mesh.num_faces(), mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+				for (std::size_t f = begin; f < end; ++f) {
+					double x = 0, y = 0, z = 0;
+					for (const index_t h : mesh.fh_range(f)) {
+						const double u = m_heat[mesh.halfedge(mesh.halfedge(h).next).vertex];
+						x += u * m_gradients.x[h];
+						y += u * m_gradients.y[h];
+						z += u * m_gradients.z[h];
+					}
+					const double length = std::sqrt(x * x + y * y + z * z);
+					const double scale = length > 0 ? -1 / length : 0;
+					m_field.x[f] = x * scale;
+					m_field.y[f] = y * scale;
+					m_field.z[f] = z * scale;
+				}
+			});
+
+			// Integrated divergence at vertex i: 1/2 sum over its faces of cot(j) (e_ik . X) + cot(k) (e_ij . X).
+			// Each vertex gathers from its own faces, so the threads never write the same vertex.
+			parallel_for(0, num_vertices, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; ++i) {
+					double divergence = 0;
+					for (const index_t he_index : mesh.voh_range(i)) {
+						const trimesh_t::halfedge_t& he = mesh.halfedge(he_index);
+						if (he.face == -1) { continue; }
+						const index_t prev = mesh.halfedge(he.next).next;
+						const index_t j = he.vertex, k = mesh.halfedge(he.next).vertex, f = he.face;
+						const double ij = (m_positions.x[j] - m_positions.x[i]) * m_field.x[f] + (m_positions.y[j] - m_positions.y[i]) * m_field.y[f] + (m_positions.z[j] - m_positions.z[i]) * m_field.z[f];
+						const double ik = (m_positions.x[k] - m_positions.x[i]) * m_field.x[f] + (m_positions.y[k] - m_positions.y[i]) * m_field.y[f] + (m_positions.z[k] - m_positions.z[i]) * m_field.z[f];
+						divergence += 0.5 * (m_cotangents[he_index] * ij + m_cotangents[prev] * ik);
+					}
+					m_divergence[i] = -divergence;
+				}
+			});
+
+			// -L phi = -div X.
+			m_distance = m_poisson_solver.solve(m_divergence);
+			double shift = 0;
+			for (const index_t s : sources) { shift += m_distance[s] / sources.size(); }
+			distances.resize(num_vertices);
+			for (std::size_t v = 0; v < num_vertices; ++v) {
+				distances[v] = m_isolated[v] ? std::numeric_limits<double>::infinity() : m_distance[v] - shift;
+			}
+		}
+	};
+}
+
+#endif // !__geodesic_heat_h__
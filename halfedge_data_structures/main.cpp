@@ -30,12 +30,9 @@ int main()
 	triangles[1].j() = 1;
 	triangles[1].k() = 3;
 
-	// Edges
-	std::vector<trimesh::edge_t> edges;
-	mesh.triangles2edges(triangles.size(), &triangles[0], edges);
-
 	// Triangle mesh
-	mesh.build(num_vertices, triangles.size(), &triangles[0], edges.size(), &edges[0]);
+	// The same as mesh.triangles2edges() followed by mesh.build(), in a single pass.
+	mesh.build_from_triangles(num_vertices, triangles.size(), &triangles[0]);
 
 	// Traverse all the one-ring neighbors of each vertex.
 	std::vector<trimesh::index_t> neighbors;
@@ -48,5 +45,14 @@ int main()
 		std::cout << '\n';
 	}
 
+	// Traverse the incident faces of each vertex with a circulator, without filling a vector.
+	for (int i = 0; i < num_vertices; ++i) {
+		std::cout << "Faces of vertex " << i << ": ";
+		for (const trimesh::index_t face : mesh.vf_range(i)) {
+			std::cout << face << ' ';
+		}
+		std::cout << '\n';
+	}
+
 	return 0;
 }
\ No newline at end of file
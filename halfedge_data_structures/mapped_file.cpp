@@ -0,0 +1,56 @@
+#include"mapped_file.h"
+#include<cstdio>
+
+#ifndef _WIN32
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#endif
+
+namespace trimesh
+{
+	mapped_file_t::~mapped_file_t()
+	{
+#ifndef _WIN32
+		munmap(m_data, m_size);
+#else
+		delete[] static_cast<char*>(m_data);
+#endif
+	}
+
+	std::shared_ptr<mapped_file_t> mapped_file_t::open(const char* filename)
+	{
+#ifndef _WIN32
+		const int fd = ::open(filename, O_RDONLY);
+		if (fd < 0) { return nullptr; }
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			close(fd);
+			return nullptr;
+		}
+		void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);  // The mapping stays valid after closing the file.
+		if (data == MAP_FAILED) { return nullptr; }
+		return std::shared_ptr<mapped_file_t>(new mapped_file_t(data, st.st_size));
+#else
+		std::FILE* file = std::fopen(filename, "rb");
+		if (!file) { return nullptr; }
+		std::fseek(file, 0, SEEK_END);
+		const long size = std::ftell(file);
+		std::fseek(file, 0, SEEK_SET);
+		if (size <= 0) {
+			std::fclose(file);
+			return nullptr;
+		}
+		char* data = new char[size];
+		const bool ok = std::fread(data, 1, size, file) == std::size_t(size);
+		std::fclose(file);
+		if (!ok) {
+			delete[] data;
+			return nullptr;
+		}
+		return std::shared_ptr<mapped_file_t>(new mapped_file_t(data, size));
+#endif
+	}
+}
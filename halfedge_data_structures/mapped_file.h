@@ -0,0 +1,40 @@
+#ifndef __mapped_file_h__
+#define __mapped_file_h__
+
+#include<cstddef>
+#include<memory>
+
+namespace trimesh
+{
+	/*
+	* Name: mapped_file_t
+	* Func: A whole file mapped read-only into memory, unmapped on destruction.
+	* Without mmap (_WIN32) the file is read into memory instead.
+	* @Varia m_data: The first byte of the file.
+	* @Varia m_size: The size of the file in bytes.
+	*/
+	class mapped_file_t
+	{
+	private:
+		void* m_data;
+		std::size_t m_size;
+
+		mapped_file_t(void* data, std::size_t size) : m_data(data), m_size(size) {}
+		mapped_file_t(const mapped_file_t&) = delete;
+		mapped_file_t& operator=(const mapped_file_t&) = delete;
+
+	public:
+		~mapped_file_t();
+
+		/*
+		* Name: open
+		* Func: Map the file. Return nullptr if it can't be opened or is empty.
+		*/
+		static std::shared_ptr<mapped_file_t> open(const char* filename);
+
+		const char* data() const { return static_cast<const char*>(m_data); }
+		std::size_t size() const { return m_size; }
+	};
+}
+
+#endif // !__mapped_file_h__
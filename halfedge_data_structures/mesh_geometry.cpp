@@ -0,0 +1,133 @@
+#include"mesh_geometry.h"
+#include"parallel.h"
+#include<cmath>
+#include<cassert>
+#include<algorithm>
+#include<limits>
+
+namespace trimesh
+{
+	namespace
+	{
+		// Elements per block: small enough for the gathered arrays to stay in L1.
+		const std::size_t block_size = 256;
+
+		/*
+		* Name: normalize
+		* Func: Normalize n vectors in place and write their lengths into "lengths". Zero vectors stay zero.
+		*/
+		template<typename scalar_t>
+		void normalize(scalar_t* x, scalar_t* y, scalar_t* z, scalar_t* lengths, std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; ++i) {
+				const scalar_t length = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+				// Branch-free, so that the loop vectorizes: a zero vector times a large finite inverse stays zero.
+				const scalar_t inverse = scalar_t(1) / (length + std::numeric_limits<scalar_t>::min());
+				x[i] *= inverse;
+				y[i] *= inverse;
+				z[i] *= inverse;
+				lengths[i] = length;
+			}
+		}
+	}
+
+	template<typename scalar_t>
+	void compute_face_normals(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, soa3_t<scalar_t>& face_normals, std::vector<scalar_t>& face_areas)
+	{
+		assert(positions.size() == std::size_t(mesh.num_vertices()));
+		const std::size_t num_faces = mesh.num_faces();
+		face_normals.resize(num_faces);
+		face_areas.resize(num_faces);
+
+		const scalar_t* px = positions.x.data();
+		const scalar_t* py = positions.y.data();
+		const scalar_t* pz = positions.z.data();
+		scalar_t* nx = face_normals.x.data();
+		scalar_t* ny = face_normals.y.data();
+		scalar_t* nz = face_normals.z.data();
+		scalar_t* areas = face_areas.data();
+
+		parallel_for(0, num_faces, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			// The two edge vectors (v0, v1) and (v0, v2) of each face in the block.
+			scalar_t ux[block_size], uy[block_size], uz[block_size];
+			scalar_t vx[block_size], vy[block_size], vz[block_size];
+
+			for (std::size_t block = begin; block < end; block += block_size) {
+				const std::size_t n = std::min(block_size, end - block);
+
+				// Gather: walk the halfedges of each face.
+				for (std::size_t i = 0; i < n; ++i) {
+					const index_t h0 = mesh.face_halfedge(block + i);
+					if (h0 == -1) {
+						ux[i] = uy[i] = uz[i] = vx[i] = vy[i] = vz[i] = 0;
+						continue;
+					}
+					const trimesh_t::halfedge_t& he0 = mesh.halfedge(h0);
+					const trimesh_t::halfedge_t& he1 = mesh.halfedge(he0.next);
+					const index_t v0 = mesh.halfedge(he1.next).vertex, v1 = he0.vertex, v2 = he1.vertex;
+					ux[i] = px[v1] - px[v0];
+					uy[i] = py[v1] - py[v0];
+					uz[i] = pz[v1] - pz[v0];
+					vx[i] = px[v2] - px[v0];
+					vy[i] = py[v2] - py[v0];
+					vz[i] = pz[v2] - pz[v0];
+				}
+
+				// Compute: straight-line arithmetic on contiguous arrays.
+				scalar_t* bx = nx + block;
+				scalar_t* by = ny + block;
+				scalar_t* bz = nz + block;
+				for (std::size_t i = 0; i < n; ++i) {
+					bx[i] = uy[i] * vz[i] - uz[i] * vy[i];
+					by[i] = uz[i] * vx[i] - ux[i] * vz[i];
+					bz[i] = ux[i] * vy[i] - uy[i] * vx[i];
+				}
+				normalize(bx, by, bz, areas + block, n);
+				for (std::size_t i = 0; i < n; ++i) { areas[block + i] *= scalar_t(0.5); }
+			}
+		});
+	}
+
+	template<typename scalar_t>
+	void compute_vertex_normals(const trimesh_t& mesh, const soa3_t<scalar_t>& face_normals, const std::vector<scalar_t>& face_areas, soa3_t<scalar_t>& vertex_normals)
+	{
+		assert(face_normals.size() == std::size_t(mesh.num_faces()) && face_areas.size() == std::size_t(mesh.num_faces()));
+		const std::size_t num_vertices = mesh.num_vertices();
+		vertex_normals.resize(num_vertices);
+
+		const scalar_t* fx = face_normals.x.data();
+		const scalar_t* fy = face_normals.y.data();
+		const scalar_t* fz = face_normals.z.data();
+		const scalar_t* areas = face_areas.data();
+		scalar_t* nx = vertex_normals.x.data();
+		scalar_t* ny = vertex_normals.y.data();
+		scalar_t* nz = vertex_normals.z.data();
+
+		parallel_for(0, num_vertices, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			scalar_t lengths[block_size];
+
+			for (std::size_t block = begin; block < end; block += block_size) {
+				const std::size_t n = std::min(block_size, end - block);
+
+				// Each vertex sums over its own faces, so the threads never write the same vertex.
+				for (std::size_t v = block; v < block + n; ++v) {
+					scalar_t sx = 0, sy = 0, sz = 0;
+					for (const index_t f : mesh.vf_range(v)) {
+						sx += areas[f] * fx[f];
+						sy += areas[f] * fy[f];
+						sz += areas[f] * fz[f];
+					}
+					nx[v] = sx;
+					ny[v] = sy;
+					nz[v] = sz;
+				}
+				normalize(nx + block, ny + block, nz + block, lengths, n);
+			}
+		});
+	}
+
+	template void compute_face_normals<float>(const trimesh_t&, const soa3_t<float>&, soa3_t<float>&, std::vector<float>&);
+	template void compute_face_normals<double>(const trimesh_t&, const soa3_t<double>&, soa3_t<double>&, std::vector<double>&);
+	template void compute_vertex_normals<float>(const trimesh_t&, const soa3_t<float>&, const std::vector<float>&, soa3_t<float>&);
+	template void compute_vertex_normals<double>(const trimesh_t&, const soa3_t<double>&, const std::vector<double>&, soa3_t<double>&);
+}
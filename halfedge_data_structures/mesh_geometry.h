@@ -0,0 +1,39 @@
+#ifndef __mesh_geometry_h__
+#define __mesh_geometry_h__
+
+#include"trimesh.h"
+#include"mesh_properties.h"
+
+namespace trimesh
+{
+	/*
+	* Name: compute_face_normals
+	* Func: Compute the unit normal and the area of each face from the vertex positions. Deleted faces get a zero normal and area.
+	* Faces are processed in blocks: the vertices of a block are gathered through the halfedges first,
+	* then the cross products run over contiguous arrays, which the compiler vectorizes.
+	* Uses the threads of the mesh, see "set_num_threads". Instantiated for float and double.
+	*/
+	template<typename scalar_t>
+	void compute_face_normals(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, soa3_t<scalar_t>& face_normals, std::vector<scalar_t>& face_areas);
+
+	/*
+	* Name: compute_vertex_normals
+	* Func: Compute the unit normal of each vertex as the area-weighted sum of the normals of its faces.
+	* Vertices without faces get a zero normal.
+	*/
+	template<typename scalar_t>
+	void compute_vertex_normals(const trimesh_t& mesh, const soa3_t<scalar_t>& face_normals, const std::vector<scalar_t>& face_areas, soa3_t<scalar_t>& vertex_normals);
+
+	/*
+	* Name: compute_normals
+	* Func: compute_face_normals followed by compute_vertex_normals on the properties of the mesh.
+	*/
+	template<typename scalar_t>
+	void compute_normals(const trimesh_t& mesh, mesh_properties_t<scalar_t>& properties)
+	{
+		compute_face_normals(mesh, properties.positions, properties.face_normals, properties.face_areas);
+		compute_vertex_normals(mesh, properties.face_normals, properties.face_areas, properties.vertex_normals);
+	}
+}
+
+#endif // !__mesh_geometry_h__
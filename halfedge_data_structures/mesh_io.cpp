@@ -0,0 +1,585 @@
+#include"mesh_io.h"
+#include"mapped_file.h"
+#include"parallel.h"
+#include<charconv>
+#include<cstring>
+#include<cstdint>
+#include<cstdlib>
+#include<cctype>
+#include<string>
+#include<algorithm>
+
+namespace trimesh
+{
+	namespace
+	{
+		bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+		const char* skip_blank(const char* p, const char* end)
+		{
+			while (p < end && is_blank(*p)) { ++p; }
+			return p;
+		}
+
+		const char* skip_token(const char* p, const char* end)
+		{
+			while (p < end && !is_blank(*p) && *p != '\n') { ++p; }
+			return p;
+		}
+
+		// Return the end of the line starting at "p", i.e. its '\n' or "end".
+		const char* line_end(const char* p, const char* end)
+		{
+			const void* newline = std::memchr(p, '\n', end - p);
+			return newline ? static_cast<const char*>(newline) : end;
+		}
+
+		// Return the end of the content of the line starting at "p": its '\n', its first '#', or "end".
+		const char* content_end(const char* p, const char* end)
+		{
+			const char* e = line_end(p, end);
+			return std::find(p, e, '#');
+		}
+
+		// Return the start of the line after the one containing "p".
+		const char* next_line(const char* p, const char* end)
+		{
+			const char* e = line_end(p, end);
+			return e < end ? e + 1 : end;
+		}
+
+		// Return the first line start at or after "p" in the text starting at "begin".
+		const char* align_to_line(const char* begin, const char* p, const char* end)
+		{
+			if (p <= begin) { return begin; }
+			if (p >= end) { return end; }
+			return p[-1] == '\n' ? p : next_line(p, end);
+		}
+
+		bool parse_double(const char*& p, const char* end, double& value)
+		{
+			p = skip_blank(p, end);
+			if (p < end && *p == '+') { ++p; }
+			const std::from_chars_result result = std::from_chars(p, end, value);
+			if (result.ec != std::errc()) { return false; }
+			p = result.ptr;
+			return true;
+		}
+
+		bool parse_index(const char*& p, const char* end, long& value)
+		{
+			p = skip_blank(p, end);
+			if (p < end && *p == '+') { ++p; }
+			const std::from_chars_result result = std::from_chars(p, end, value);
+			if (result.ec != std::errc()) { return false; }
+			p = result.ptr;
+			return true;
+		}
+
+		// A line is skipped if it's empty or a '#' comment.
+		bool is_content_line(const char* p, const char* end)
+		{
+			p = skip_blank(p, end);
+			return p < end && *p != '\n' && *p != '#';
+		}
+
+		/*
+		* Name: for_each_chunk
+		* Func: Split the text [begin, end) into one chunk of whole lines per thread and call f(thread, chunk_begin, chunk_end) on each.
+		* The chunks are the same for the same arguments, so several passes can share per-chunk counts.
+		*/
+		template<typename function_t>
+		void for_each_chunk(const char* begin, const char* end, unsigned num_threads, const function_t& f)
+		{
+			parallel_for(0, end - begin, num_threads, [&](unsigned t, std::size_t b, std::size_t e) {
+				f(t, align_to_line(begin, begin + b, end), align_to_line(begin, begin + e, end));
+			});
+		}
+
+		// Turn per-chunk counts into the index of the first element of each chunk, and return the total.
+		std::size_t exclusive_scan(std::vector<std::size_t>& counts)
+		{
+			std::size_t sum = 0;
+			for (auto it = counts.begin(); it != counts.end(); ++it) {
+				const std::size_t c = *it;
+				*it = sum;
+				sum += c;
+			}
+			return sum;
+		}
+
+		bool all_of(const std::vector<char>& ok)
+		{
+			return std::find(ok.begin(), ok.end(), 0) == ok.end();
+		}
+
+		/*
+		* Name: fan_t
+		* Func: Split a polygon streamed vertex by vertex into the triangles (v0, v1, v2), (v0, v2, v3), ...
+		*/
+		struct fan_t
+		{
+			triangle_t* out;
+			long first, previous, count;
+
+			explicit fan_t(triangle_t* out) : out(out), first(-1), previous(-1), count(0) {}
+
+			void add(long vertex)
+			{
+				if (count == 0) { first = vertex; }
+				else if (count >= 2) {
+					out->i() = first;
+					out->j() = previous;
+					out->k() = vertex;
+					++out;
+				}
+				previous = vertex;
+				++count;
+			}
+		};
+
+		// Read the next whitespace-separated header token, skipping '#' comments.
+		bool next_header_token(const char*& p, const char* end, std::string& token)
+		{
+			while (p < end) {
+				if (is_blank(*p) || *p == '\n') { ++p; }
+				else if (*p == '#') { p = next_line(p, end); }
+				else { break; }
+			}
+			if (p == end) { return false; }
+			const char* e = skip_token(p, end);
+			token.assign(p, e);
+			p = e;
+			return true;
+		}
+
+		/*
+		* PLY property types and their sizes in bytes.
+		*/
+		enum ply_type_t { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_INVALID };
+		const std::size_t ply_type_size[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+		ply_type_t ply_type(const std::string& name)
+		{
+			if (name == "char" || name == "int8") { return PLY_INT8; }
+			if (name == "uchar" || name == "uint8") { return PLY_UINT8; }
+			if (name == "short" || name == "int16") { return PLY_INT16; }
+			if (name == "ushort" || name == "uint16") { return PLY_UINT16; }
+			if (name == "int" || name == "int32") { return PLY_INT32; }
+			if (name == "uint" || name == "uint32") { return PLY_UINT32; }
+			if (name == "float" || name == "float32") { return PLY_FLOAT32; }
+			if (name == "double" || name == "float64") { return PLY_FLOAT64; }
+			return PLY_INVALID;
+		}
+
+		template<typename T>
+		T load(const char* p, bool swap)
+		{
+			char bytes[sizeof(T)];
+			std::memcpy(bytes, p, sizeof(T));
+			if (swap) { std::reverse(bytes, bytes + sizeof(T)); }
+			T value;
+			std::memcpy(&value, bytes, sizeof(T));
+			return value;
+		}
+
+		double load_ply(const char* p, ply_type_t type, bool swap)
+		{
+			switch (type) {
+			case PLY_INT8: return load<std::int8_t>(p, swap);
+			case PLY_UINT8: return load<std::uint8_t>(p, swap);
+			case PLY_INT16: return load<std::int16_t>(p, swap);
+			case PLY_UINT16: return load<std::uint16_t>(p, swap);
+			case PLY_INT32: return load<std::int32_t>(p, swap);
+			case PLY_UINT32: return load<std::uint32_t>(p, swap);
+			case PLY_FLOAT32: return load<float>(p, swap);
+			default: return load<double>(p, swap);
+			}
+		}
+
+		/*
+		* Name: ply_property_t/ply_element_t
+		* Func: A property (maybe a list, whose length is stored with "count_type") and an element of a PLY header.
+		*/
+		struct ply_property_t
+		{
+			std::string name;
+			ply_type_t type;
+			ply_type_t count_type;
+			bool is_list;
+		};
+
+		struct ply_element_t
+		{
+			std::string name;
+			std::size_t count;
+			std::vector<ply_property_t> properties;
+
+			// The size of a record, or 0 if it contains a list.
+			std::size_t stride() const
+			{
+				std::size_t size = 0;
+				for (auto it = properties.begin(); it != properties.end(); ++it) {
+					if (it->is_list) { return 0; }
+					size += ply_type_size[it->type];
+				}
+				return size;
+			}
+
+			// The offset of a property in a record without lists, or -1 if it doesn't exist.
+			long offset_of(const char* name) const
+			{
+				long offset = 0;
+				for (auto it = properties.begin(); it != properties.end(); ++it) {
+					if (it->name == name) { return offset; }
+					offset += ply_type_size[it->type];
+				}
+				return -1;
+			}
+		};
+
+		// Return the end of the record at "p", or nullptr if it goes past "end".
+		const char* skip_ply_record(const ply_element_t& element, const char* p, const char* end, bool swap)
+		{
+			for (auto it = element.properties.begin(); it != element.properties.end(); ++it) {
+				std::size_t n = 1;
+				if (it->is_list) {
+					if (p + ply_type_size[it->count_type] > end) { return nullptr; }
+					n = std::size_t(load_ply(p, it->count_type, swap));
+					p += ply_type_size[it->count_type];
+				}
+				if (std::size_t(end - p) < n * ply_type_size[it->type]) { return nullptr; }
+				p += n * ply_type_size[it->type];
+			}
+			return p;
+		}
+	}
+
+	bool read_off(const char* filename, std::vector<double>& positions, std::vector<triangle_t>& triangles, unsigned num_threads)
+	{
+		std::shared_ptr<mapped_file_t> file = mapped_file_t::open(filename);
+		if (!file) { return false; }
+		const char* p = file->data();
+		const char* end = p + file->size();
+
+		// Header: "OFF" (or a variant like "COFF"), then the numbers of vertices, faces and edges.
+		std::string token;
+		if (!next_header_token(p, end, token) || token.size() < 3 || token.compare(token.size() - 3, 3, "OFF") != 0) { return false; }
+		long counts[3];
+		for (int i = 0; i < 3; ++i) {
+			if (!next_header_token(p, end, token)) { return false; }
+			const char* t = token.c_str();
+			if (!parse_index(t, t + token.size(), counts[i]) || counts[i] < 0) { return false; }
+		}
+		const long num_vertices = counts[0], num_faces = counts[1];
+		const char* body = next_line(p, end);
+
+		// Pass 1: count the content lines of each chunk, to know which lines are vertices and which are faces.
+		num_threads = resolve_num_threads(num_threads);
+		std::vector<std::size_t> first_line(num_threads, 0);
+		for_each_chunk(body, end, num_threads, [&](unsigned t, const char* b, const char* e) {
+			for (const char* line = b; line < e; line = next_line(line, e)) {
+				if (is_content_line(line, e)) { ++first_line[t]; }
+			}
+		});
+		if (exclusive_scan(first_line) < std::size_t(num_vertices + num_faces)) { return false; }
+
+		// Pass 2: count the triangles of the faces of each chunk.
+		std::vector<std::size_t> first_triangle(num_threads, 0);
+		std::vector<char> ok(num_threads, 1);
+		for_each_chunk(body, end, num_threads, [&](unsigned t, const char* b, const char* e) {
+			long line_index = first_line[t];
+			for (const char* line = b; line < e; line = next_line(line, e)) {
+				if (!is_content_line(line, e)) { continue; }
+				if (line_index >= num_vertices && line_index < num_vertices + num_faces) {
+					const char* q = line;
+					long n;
+					if (!parse_index(q, e, n) || n < 0) { ok[t] = 0; return; }
+					first_triangle[t] += std::max(n - 2, 0l);
+				}
+				++line_index;
+			}
+		});
+		if (!all_of(ok)) { return false; }
+
+		// Pass 3: parse the vertices and faces directly into place.
+		positions.resize(3 * num_vertices);
+		triangles.resize(exclusive_scan(first_triangle));
+		for_each_chunk(body, end, num_threads, [&](unsigned t, const char* b, const char* e) {
+			long line_index = first_line[t];
+			fan_t fan(triangles.data() + first_triangle[t]);
+			for (const char* line = b; line < e && line_index < num_vertices + num_faces; line = next_line(line, e)) {
+				if (!is_content_line(line, e)) { continue; }
+				const char* q = line;
+				const char* le = line_end(line, e);
+				if (line_index < num_vertices) {
+					double* xyz = positions.data() + 3 * line_index;
+					if (!parse_double(q, le, xyz[0]) || !parse_double(q, le, xyz[1]) || !parse_double(q, le, xyz[2])) { ok[t] = 0; return; }
+				}
+				else {
+					long n, vertex;
+					parse_index(q, le, n);
+					fan.count = 0;
+					for (long i = 0; i < n; ++i) {
+						if (!parse_index(q, le, vertex) || vertex < 0 || vertex >= num_vertices) { ok[t] = 0; return; }
+						fan.add(vertex);
+					}
+				}
+				++line_index;
+			}
+		});
+		return all_of(ok);
+	}
+
+	bool read_obj(const char* filename, std::vector<double>& positions, std::vector<triangle_t>& triangles, unsigned num_threads)
+	{
+		std::shared_ptr<mapped_file_t> file = mapped_file_t::open(filename);
+		if (!file) { return false; }
+		const char* begin = file->data();
+		const char* end = begin + file->size();
+
+		// Only "v x y z" and "f i j k ..." lines are read, up to a trailing '#' comment. Face corners may be "i", "i/t", "i//n" or "i/t/n".
+		auto line_type = [](const char* line, const char* e) -> char {
+			line = skip_blank(line, e);
+			if (e - line >= 2 && (line[0] == 'v' || line[0] == 'f') && is_blank(line[1])) { return line[0]; }
+			return 0;
+		};
+
+		// Pass 1: count the vertices and triangles of each chunk.
+		num_threads = resolve_num_threads(num_threads);
+		std::vector<std::size_t> first_vertex(num_threads, 0), first_triangle(num_threads, 0);
+		for_each_chunk(begin, end, num_threads, [&](unsigned t, const char* b, const char* e) {
+			for (const char* line = b; line < e; line = next_line(line, e)) {
+				const char type = line_type(line, e);
+				if (type == 'v') { ++first_vertex[t]; }
+				else if (type == 'f') {
+					const char* le = content_end(line, e);
+					const char* q = skip_blank(line, le) + 1;
+					long n = 0;
+					for (q = skip_blank(q, le); q < le; q = skip_blank(skip_token(q, le), le)) { ++n; }
+					first_triangle[t] += std::max(n - 2, 0l);
+				}
+			}
+		});
+		const long num_vertices = exclusive_scan(first_vertex);
+		positions.resize(3 * num_vertices);
+		triangles.resize(exclusive_scan(first_triangle));
+
+		// Pass 2: parse directly into place. Negative indices count back from the last vertex read so far.
+		std::vector<char> ok(num_threads, 1);
+		for_each_chunk(begin, end, num_threads, [&](unsigned t, const char* b, const char* e) {
+			long vertex_index = first_vertex[t];
+			fan_t fan(triangles.data() + first_triangle[t]);
+			for (const char* line = b; line < e; line = next_line(line, e)) {
+				const char type = line_type(line, e);
+				if (!type) { continue; }
+				const char* le = content_end(line, e);
+				const char* q = skip_blank(line, le) + 1;
+				if (type == 'v') {
+					double* xyz = positions.data() + 3 * vertex_index;
+					if (!parse_double(q, le, xyz[0]) || !parse_double(q, le, xyz[1]) || !parse_double(q, le, xyz[2])) { ok[t] = 0; return; }
+					++vertex_index;
+				}
+				else {
+					fan.count = 0;
+					for (q = skip_blank(q, le); q < le; q = skip_blank(skip_token(q, le), le)) {
+						long vertex;
+						if (!parse_index(q, le, vertex) || vertex == 0) { ok[t] = 0; return; }
+						vertex = vertex < 0 ? vertex_index + vertex : vertex - 1;
+						if (vertex < 0 || vertex >= num_vertices) { ok[t] = 0; return; }
+						fan.add(vertex);
+					}
+				}
+			}
+		});
+		return all_of(ok);
+	}
+
+	bool read_ply(const char* filename, std::vector<double>& positions, std::vector<triangle_t>& triangles, unsigned num_threads)
+	{
+		std::shared_ptr<mapped_file_t> file = mapped_file_t::open(filename);
+		if (!file) { return false; }
+		const char* p = file->data();
+		const char* end = p + file->size();
+
+		// Header, line by line until "end_header".
+		if (file->size() < 4 || std::memcmp(p, "ply", 3) != 0) { return false; }
+		bool little_endian = true;
+		std::vector<ply_element_t> elements;
+		for (p = next_line(p, end); ; p = next_line(p, end)) {
+			if (p == end) { return false; }
+			const char* le = line_end(p, end);
+			std::vector<std::string> tokens;
+			for (const char* q = skip_blank(p, le); q < le; q = skip_blank(q, le)) {
+				const char* e = skip_token(q, le);
+				tokens.emplace_back(q, e);
+				q = e;
+			}
+			if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info") { continue; }
+			if (tokens[0] == "end_header") {
+				p = next_line(p, end);
+				break;
+			}
+			if (tokens[0] == "format" && tokens.size() >= 2) {
+				if (tokens[1] == "binary_little_endian") { little_endian = true; }
+				else if (tokens[1] == "binary_big_endian") { little_endian = false; }
+				else { return false; }  // ASCII PLY isn't supported.
+			}
+			else if (tokens[0] == "element" && tokens.size() == 3) {
+				ply_element_t element;
+				element.name = tokens[1];
+				element.count = std::strtoull(tokens[2].c_str(), nullptr, 10);
+				elements.push_back(element);
+			}
+			else if (tokens[0] == "property" && !elements.empty()) {
+				ply_property_t property;
+				property.is_list = tokens.size() == 5 && tokens[1] == "list";
+				if (!property.is_list && tokens.size() != 3) { return false; }
+				property.count_type = property.is_list ? ply_type(tokens[2]) : PLY_UINT8;
+				property.type = ply_type(tokens[property.is_list ? 3 : 1]);
+				property.name = tokens.back();
+				if (property.type == PLY_INVALID || property.count_type == PLY_INVALID) { return false; }
+				elements.back().properties.push_back(property);
+			}
+			else { return false; }
+		}
+
+		const std::uint16_t one = 1;
+		const bool host_little_endian = *reinterpret_cast<const char*>(&one) == 1;
+		const bool swap = little_endian != host_little_endian;
+
+		// Locate the vertex and face elements. Elements with lists before them are skipped record by record,
+		// so the search stops at the start of the second one: the face list is only walked if the vertices follow it.
+		const ply_element_t* vertex_element = nullptr;
+		const ply_element_t* face_element = nullptr;
+		const char* vertex_data = nullptr;
+		const char* face_data = nullptr;
+		for (auto it = elements.begin(); it != elements.end(); ++it) {
+			if (it->name == "vertex") {
+				vertex_element = &*it;
+				vertex_data = p;
+			}
+			else if (it->name == "face") {
+				face_element = &*it;
+				face_data = p;
+			}
+			if (vertex_element && face_element) { break; }
+			const std::size_t stride = it->stride();
+			if (stride != 0) {
+				if (std::size_t(end - p) / stride < it->count) { return false; }
+				p += stride * it->count;
+			}
+			else {
+				for (std::size_t i = 0; i < it->count && p; ++i) { p = skip_ply_record(*it, p, end, swap); }
+				if (!p) { return false; }
+			}
+		}
+		if (!vertex_element || !face_element) { return false; }
+
+		// Vertices: fixed-size records, converted in parallel.
+		num_threads = resolve_num_threads(num_threads);
+		const std::size_t num_vertices = vertex_element->count;
+		const std::size_t vertex_stride = vertex_element->stride();
+		long offset[3] = { vertex_element->offset_of("x"), vertex_element->offset_of("y"), vertex_element->offset_of("z") };
+		if (vertex_stride == 0 || offset[0] < 0 || offset[1] < 0 || offset[2] < 0) { return false; }
+		if (std::size_t(end - vertex_data) / vertex_stride < num_vertices) { return false; }
+		ply_type_t type[3];
+		for (int c = 0; c < 3; ++c) {
+			for (auto it = vertex_element->properties.begin(); it != vertex_element->properties.end(); ++it) {
+				if (it->name == std::string(1, char('x' + c))) { type[c] = it->type; }
+			}
+		}
+		positions.resize(3 * num_vertices);
+		parallel_for(0, num_vertices, num_threads, [&](unsigned, std::size_t b, std::size_t e) {
+			for (std::size_t i = b; i < e; ++i) {
+				const char* record = vertex_data + i * vertex_stride;
+				for (int c = 0; c < 3; ++c) {
+					positions[3 * i + c] = load_ply(record + offset[c], type[c], swap);
+				}
+			}
+		});
+
+		// Faces: the list property "vertex_indices" (or "vertex_index").
+		long list = -1;
+		for (std::size_t i = 0; i < face_element->properties.size(); ++i) {
+			const ply_property_t& property = face_element->properties[i];
+			if (property.is_list && (property.name == "vertex_indices" || property.name == "vertex_index")) { list = i; }
+		}
+		if (list < 0) { return false; }
+		const ply_property_t& indices = face_element->properties[list];
+		const std::size_t num_faces = face_element->count;
+		const std::size_t count_size = ply_type_size[indices.count_type];
+		const std::size_t index_size = ply_type_size[indices.type];
+
+		// Fast path: if the list is the only property and every face is a triangle, the records have a fixed size.
+		std::vector<char> ok(num_threads, 1);
+		const std::size_t triangle_stride = count_size + 3 * index_size;
+		if (face_element->properties.size() == 1 && std::size_t(end - face_data) / triangle_stride >= num_faces) {
+			parallel_for(0, num_faces, num_threads, [&](unsigned t, std::size_t b, std::size_t e) {
+				for (std::size_t i = b; i < e && ok[t]; ++i) {
+					ok[t] = load_ply(face_data + i * triangle_stride, indices.count_type, swap) == 3;
+				}
+			});
+			if (all_of(ok)) {
+				triangles.resize(num_faces);
+				parallel_for(0, num_faces, num_threads, [&](unsigned t, std::size_t b, std::size_t e) {
+					for (std::size_t i = b; i < e; ++i) {
+						const char* record = face_data + i * triangle_stride + count_size;
+						long vertex[3];
+						for (int c = 0; c < 3; ++c) {
+							vertex[c] = long(load_ply(record + c * index_size, indices.type, swap));
+							if (vertex[c] < 0 || std::size_t(vertex[c]) >= num_vertices) { ok[t] = 0; }
+						}
+						triangles[i].i() = vertex[0];
+						triangles[i].j() = vertex[1];
+						triangles[i].k() = vertex[2];
+					}
+				});
+				return all_of(ok);
+			}
+		}
+
+		// General case: walk the variable-size records one by one.
+		triangles.clear();
+		triangles.reserve(num_faces);
+		p = face_data;
+		for (std::size_t i = 0; i < num_faces; ++i) {
+			for (std::size_t k = 0; k < face_element->properties.size(); ++k) {
+				const ply_property_t& property = face_element->properties[k];
+				std::size_t n = 1;
+				if (property.is_list) {
+					if (std::size_t(end - p) < ply_type_size[property.count_type]) { return false; }
+					n = std::size_t(load_ply(p, property.count_type, swap));
+					p += ply_type_size[property.count_type];
+				}
+				if (std::size_t(end - p) / ply_type_size[property.type] < n) { return false; }
+				if (long(k) == list) {
+					const std::size_t first = triangles.size();
+					triangles.resize(first + (n > 2 ? n - 2 : 0));
+					fan_t fan(triangles.data() + first);
+					for (std::size_t c = 0; c < n; ++c) {
+						const long vertex = long(load_ply(p + c * index_size, property.type, swap));
+						if (vertex < 0 || std::size_t(vertex) >= num_vertices) { return false; }
+						fan.add(vertex);
+					}
+				}
+				p += n * ply_type_size[property.type];
+			}
+		}
+		return true;
+	}
+
+	bool read_mesh(const char* filename, std::vector<double>& positions, std::vector<triangle_t>& triangles, unsigned num_threads)
+	{
+		std::string extension(filename);
+		const std::size_t dot = extension.rfind('.');
+		if (dot == std::string::npos) { return false; }
+		extension = extension.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(std::tolower(c)); });
+
+		if (extension == "off") { return read_off(filename, positions, triangles, num_threads); }
+		if (extension == "obj") { return read_obj(filename, positions, triangles, num_threads); }
+		if (extension == "ply") { return read_ply(filename, positions, triangles, num_threads); }
+		return false;
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef __mesh_io_h__
+#define __mesh_io_h__
+
+#include"trimesh_types.h"
+#include<vector>
+
+namespace trimesh
+{
+	/*
+	* Name: read_off/read_obj/read_ply
+	* Func: Read a mesh file into positions (x0, y0, z0, x1, y1, z1, ...) and triangles. Polygons are split into triangle fans.
+	* Return false if the file can't be opened or is malformed, e.g. a face refers to a missing vertex.
+	* The file is memory-mapped and parsed in chunks by "num_threads" threads (0 means one per hardware thread).
+	* read_ply only reads binary (little or big endian) PLY files.
+	*/
+	bool read_off(const char* filename, std::vector<double>& positions, std::vector<triangle_t>& triangles, unsigned num_threads = 1);
+	bool read_obj(const char* filename, std::vector<double>& positions, std::vector<triangle_t>& triangles, unsigned num_threads = 1);
+	bool read_ply(const char* filename, std::vector<double>& positions, std::vector<triangle_t>& triangles, unsigned num_threads = 1);
+
+	/*
+	* Name: read_mesh
+	* Func: Call read_off, read_obj or read_ply according to the extension of the file name.
+	*/
+	bool read_mesh(const char* filename, std::vector<double>& positions, std::vector<triangle_t>& triangles, unsigned num_threads = 1);
+}
+
+#endif // !__mesh_io_h__
@@ -0,0 +1,163 @@
+#include"mesh_laplacian.h"
+#include"parallel.h"
+#include<cmath>
+#include<cassert>
+
+namespace trimesh
+{
+	namespace
+	{
+		/*
+		* Name: corner_t
+		* Func: The vectors from one corner of a triangle to the two others, e.g. (a - c, b - c) for the corner c of (a, b, c).
+		*/
+		struct corner_t
+		{
+			double ux, uy, uz, vx, vy, vz;
+
+			template<typename scalar_t>
+			corner_t(const soa3_t<scalar_t>& p, index_t a, index_t b, index_t c)
+				: ux(double(p.x[a]) - p.x[c]), uy(double(p.y[a]) - p.y[c]), uz(double(p.z[a]) - p.z[c]),
+				  vx(double(p.x[b]) - p.x[c]), vy(double(p.y[b]) - p.y[c]), vz(double(p.z[b]) - p.z[c]) {}
+
+			double dot() const { return ux * vx + uy * vy + uz * vz; }
+
+			// The squared length of the side opposite the corner.
+			double opposite_length2() const
+			{
+				const double x = ux - vx, y = uy - vy, z = uz - vz;
+				return x * x + y * y + z * z;
+			}
+
+			double cross_norm() const
+			{
+				const double x = uy * vz - uz * vy, y = uz * vx - ux * vz, z = ux * vy - uy * vx;
+				return std::sqrt(x * x + y * y + z * z);
+			}
+
+			// The cotangent of the angle at the corner. 0 for a degenerate triangle.
+			double cot() const
+			{
+				const double s = cross_norm();
+				return s > 0 ? dot() / s : 0.0;
+			}
+		};
+
+		/*
+		* Name: diagonal_matrix
+		* Func: Fill a CSR matrix with the given diagonal.
+		*/
+		void diagonal_matrix(std::vector<double>& diagonal, csr_matrix_t& matrix)
+		{
+			const index_t n = diagonal.size();
+			matrix.rows = matrix.cols = n;
+			matrix.offsets.resize(n + 1);
+			matrix.columns.resize(n);
+			for (index_t i = 0; i <= n; ++i) { matrix.offsets[i] = i; }
+			for (index_t i = 0; i < n; ++i) { matrix.columns[i] = i; }
+			matrix.values.swap(diagonal);
+		}
+	}
+
+	template<typename scalar_t>
+	void cotangent_laplacian(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, csr_matrix_t& laplacian)
+	{
+		assert(positions.size() == std::size_t(mesh.num_vertices()));
+		const std::size_t num_vertices = mesh.num_vertices();
+		laplacian.rows = laplacian.cols = num_vertices;
+		laplacian.offsets.assign(num_vertices + 1, 0);
+
+		// Row i has the diagonal and one entry per neighbor. Isolated and deleted vertices keep an empty row.
+		parallel_for(0, num_vertices, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				index_t num_entries = 0;
+				for (const index_t he_index : mesh.voh_range(i)) { (void)he_index; ++num_entries; }
+				laplacian.offsets[i + 1] = num_entries == 0 ? 0 : num_entries + 1;
+			}
+		});
+		for (std::size_t i = 0; i < num_vertices; ++i) { laplacian.offsets[i + 1] += laplacian.offsets[i]; }
+
+		laplacian.columns.resize(laplacian.offsets[num_vertices]);
+		laplacian.values.resize(laplacian.offsets[num_vertices]);
+		parallel_for(0, num_vertices, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				const index_t row_begin = laplacian.offsets[i], row_end = laplacian.offsets[i + 1];
+				if (row_begin == row_end) { continue; }
+				index_t* columns = laplacian.columns.data() + row_begin;
+				double* values = laplacian.values.data() + row_begin;
+
+				index_t n = 0;
+				double diagonal = 0;
+				auto insert = [&](index_t column, double value) {
+					// Insertion sort: the rows are as short as the valence.
+					index_t k = n++;
+					for (; k > 0 && columns[k - 1] > column; --k) {
+						columns[k] = columns[k - 1];
+						values[k] = values[k - 1];
+					}
+					columns[k] = column;
+					values[k] = value;
+				};
+
+				for (const index_t he_index : mesh.voh_range(i)) {
+					// The two angles opposite the edge (i, j), at the third vertex of each face of the edge.
+					const trimesh_t::halfedge_t& he = mesh.halfedge(he_index);
+					const trimesh_t::halfedge_t& opposite = mesh.halfedge(he.opposite);
+					const index_t j = he.vertex;
+					double weight = 0;
+					if (he.face != -1) { weight += corner_t(positions, i, j, mesh.halfedge(he.next).vertex).cot(); }
+					if (opposite.face != -1) { weight += corner_t(positions, i, j, mesh.halfedge(opposite.next).vertex).cot(); }
+					weight *= 0.5;
+					insert(j, weight);
+					diagonal -= weight;
+				}
+				insert(i, diagonal);
+			}
+		});
+	}
+
+	template<typename scalar_t>
+	void mass_matrix(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, mass_kind_t kind, csr_matrix_t& mass)
+	{
+		assert(positions.size() == std::size_t(mesh.num_vertices()));
+		const std::size_t num_vertices = mesh.num_vertices();
+		std::vector<double> diagonal(num_vertices);
+
+		// Each vertex sums its share of the triangles around it.
+		parallel_for(0, num_vertices, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				double area = 0;
+				for (const index_t he_index : mesh.voh_range(i)) {
+					const trimesh_t::halfedge_t& he = mesh.halfedge(he_index);
+					if (he.face == -1) { continue; }
+
+					// The triangle (i, j, k) and its corners.
+					const index_t j = he.vertex, k = mesh.halfedge(he.next).vertex;
+					const corner_t ci(positions, j, k, i), cj(positions, k, i, j), ck(positions, i, j, k);
+					const double triangle_area = 0.5 * ci.cross_norm();
+					if (kind == MASS_BARYCENTRIC) {
+						area += triangle_area / 3;
+					}
+					else if (ci.dot() < 0) {
+						area += triangle_area / 2;
+					}
+					else if (cj.dot() < 0 || ck.dot() < 0) {
+						area += triangle_area / 4;
+					}
+					else {
+						// Voronoi region of i: (|ij|^2 cot(k) + |ik|^2 cot(j)) / 8.
+						area += (ck.opposite_length2() * ck.cot() + cj.opposite_length2() * cj.cot()) / 8;
+					}
+				}
+				diagonal[i] = area;
+			}
+		});
+
+		diagonal_matrix(diagonal, mass);
+	}
+
+	template void cotangent_laplacian<float>(const trimesh_t&, const soa3_t<float>&, csr_matrix_t&);
+	template void cotangent_laplacian<double>(const trimesh_t&, const soa3_t<double>&, csr_matrix_t&);
+	template void mass_matrix<float>(const trimesh_t&, const soa3_t<float>&, mass_kind_t, csr_matrix_t&);
+	template void mass_matrix<double>(const trimesh_t&, const soa3_t<double>&, mass_kind_t, csr_matrix_t&);
+}
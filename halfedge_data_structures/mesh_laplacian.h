@@ -0,0 +1,51 @@
+#ifndef __mesh_laplacian_h__
+#define __mesh_laplacian_h__
+
+#include"trimesh.h"
+#include"mesh_properties.h"
+#include<vector>
+
+namespace trimesh
+{
+	/*
+	* Name: csr_matrix_t
+	* Func: Sparse matrix in compressed sparse row format, with the columns of each row sorted.
+	* @Varia offsets: The entries of row i are columns/values[offsets[i]] ... [offsets[i + 1] - 1]. The size is rows + 1.
+	* @Varia columns/values: The column and the value of each entry, row by row.
+	*/
+	struct csr_matrix_t
+	{
+		index_t rows = 0, cols = 0;
+		std::vector<index_t> offsets;
+		std::vector<index_t> columns;
+		std::vector<double> values;
+	};
+
+	/*
+	* Name: cotangent_laplacian
+	* Func: Assemble the cotangent Laplacian L of the mesh: L(i, j) = (cot(alpha_ij) + cot(beta_ij)) / 2 for each edge (i, j),
+	* where alpha_ij and beta_ij are the angles opposite the edge, and L(i, i) = -sum_j L(i, j).
+	* L is symmetric and negative semi-definite, like libigl's cotmatrix. Row i has the diagonal and one entry per neighbor.
+	* Each vertex assembles its own row by walking its outgoing halfedges, on the threads of the mesh,
+	* so the result doesn't depend on the number of threads. Instantiated for float and double positions.
+	*/
+	template<typename scalar_t>
+	void cotangent_laplacian(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, csr_matrix_t& laplacian);
+
+	/*
+	* Name: mass_kind_t
+	* Func: How "mass_matrix" splits the area of a triangle between its vertices.
+	* MASS_BARYCENTRIC gives a third to each vertex.
+	* MASS_VORONOI gives each vertex its Voronoi region, or a fixed share of obtuse triangles (Meyer et al. 2003), like libigl.
+	*/
+	enum mass_kind_t { MASS_BARYCENTRIC, MASS_VORONOI };
+
+	/*
+	* Name: mass_matrix
+	* Func: Assemble the lumped (diagonal) mass matrix M of the mesh, M(i, i) being the area of vertex[i].
+	*/
+	template<typename scalar_t>
+	void mass_matrix(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, mass_kind_t kind, csr_matrix_t& mass);
+}
+
+#endif // !__mesh_laplacian_h__
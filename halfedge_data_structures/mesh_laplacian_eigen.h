@@ -0,0 +1,31 @@
+#ifndef __mesh_laplacian_eigen_h__
+#define __mesh_laplacian_eigen_h__
+
+#include"mesh_laplacian.h"
+#include<Eigen/Sparse>
+
+namespace trimesh
+{
+	typedef Eigen::SparseMatrix<double, Eigen::RowMajor, index_t> eigen_csr_matrix_t;
+
+	/*
+	* Name: map_eigen
+	* Func: View a csr_matrix_t as a read-only Eigen row-major sparse matrix, without copying. The matrix must outlive the view.
+	*/
+	inline Eigen::Map<const eigen_csr_matrix_t> map_eigen(const csr_matrix_t& matrix)
+	{
+		return Eigen::Map<const eigen_csr_matrix_t>(matrix.rows, matrix.cols, matrix.values.size(),
+			matrix.offsets.data(), matrix.columns.data(), matrix.values.data());
+	}
+
+	/*
+	* Name: to_eigen
+	* Func: Copy a csr_matrix_t into Eigen's default (column-major, int indices) sparse matrix, as used by libigl and the solvers.
+	*/
+	inline Eigen::SparseMatrix<double> to_eigen(const csr_matrix_t& matrix)
+	{
+		return Eigen::SparseMatrix<double>(map_eigen(matrix));
+	}
+}
+
+#endif // !__mesh_laplacian_eigen_h__
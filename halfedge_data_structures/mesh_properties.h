@@ -0,0 +1,258 @@
+#ifndef __mesh_properties_h__
+#define __mesh_properties_h__
+
+#include"trimesh.h"
+#include<vector>
+#include<memory>
+#include<string>
+#include<cassert>
+
+namespace trimesh
+{
+	/*
+	* Name: permute_array
+	* Func: Move values[i] to values[permutation[i]], dropping the values mapped to -1, and leave "new_size" values.
+	* "permutation" is one of the arrays of permutation_t, from "reorder" or "garbage_collect".
+	*/
+	template<typename T>
+	void permute_array(std::vector<T>& values, const std::vector<index_t>& permutation, std::size_t new_size)
+	{
+		assert(values.size() == permutation.size());
+		std::vector<T> permuted(new_size);
+		for (std::size_t i = 0; i < permutation.size(); ++i) {
+			if (permutation[i] != -1) { permuted[permutation[i]] = values[i]; }
+		}
+		values.swap(permuted);
+	}
+
+	/*
+	* Name: soa3_t
+	* Func: 3D vectors stored as a structure of arrays: all the x, then all the y, then all the z.
+	* A kernel over consecutive elements reads each component from one contiguous array, which the compiler can vectorize.
+	*/
+	template<typename scalar_type>
+	struct soa3_t
+	{
+		typedef scalar_type scalar_t;
+
+		std::vector<scalar_t> x, y, z;
+
+		std::size_t size() const { return x.size(); }
+
+		void resize(std::size_t n)
+		{
+			x.resize(n);
+			y.resize(n);
+			z.resize(n);
+		}
+
+		/*
+		* Name: assign_interleaved/to_interleaved
+		* Func: Convert from/to interleaved (x0, y0, z0, x1, y1, z1, ...) coordinates, e.g. the positions read by mesh_io.
+		*/
+		template<typename T>
+		void assign_interleaved(const std::vector<T>& xyz)
+		{
+			const std::size_t n = xyz.size() / 3;
+			resize(n);
+			for (std::size_t i = 0; i < n; ++i) {
+				x[i] = scalar_t(xyz[3 * i + 0]);
+				y[i] = scalar_t(xyz[3 * i + 1]);
+				z[i] = scalar_t(xyz[3 * i + 2]);
+			}
+		}
+
+		template<typename T>
+		void to_interleaved(std::vector<T>& xyz) const
+		{
+			xyz.resize(3 * size());
+			for (std::size_t i = 0; i < size(); ++i) {
+				xyz[3 * i + 0] = T(x[i]);
+				xyz[3 * i + 1] = T(y[i]);
+				xyz[3 * i + 2] = T(z[i]);
+			}
+		}
+
+		void permute(const std::vector<index_t>& permutation, std::size_t new_size)
+		{
+			permute_array(x, permutation, new_size);
+			permute_array(y, permutation, new_size);
+			permute_array(z, permutation, new_size);
+		}
+	};
+
+	/*
+	* Name: property_container_t
+	* Func: Named user attributes of one kind of element, e.g. one value per vertex. Each attribute is its own std::vector.
+	* All the attributes have the size of the container, and follow "resize" and "permute".
+	* @Varia m_properties: The attributes, in the order they were added.
+	* @Varia m_size: The number of elements.
+	*/
+	class property_container_t
+	{
+	private:
+		struct property_base_t
+		{
+			std::string name;
+
+			virtual ~property_base_t() {}
+			virtual property_base_t* clone() const = 0;
+			virtual void resize(std::size_t n) = 0;
+			virtual void permute(const std::vector<index_t>& permutation, std::size_t new_size) = 0;
+		};
+
+		template<typename T>
+		struct property_t : property_base_t
+		{
+			std::vector<T> values;
+			T default_value;
+
+			property_base_t* clone() const override { return new property_t(*this); }
+			void resize(std::size_t n) override { values.resize(n, default_value); }
+			void permute(const std::vector<index_t>& permutation, std::size_t new_size) override { permute_array(values, permutation, new_size); }
+		};
+
+		std::vector<std::unique_ptr<property_base_t>> m_properties;
+		std::size_t m_size = 0;
+
+		property_base_t* find_base(const std::string& name) const
+		{
+			for (const auto& property : m_properties) {
+				if (property->name == name) { return property.get(); }
+			}
+			return nullptr;
+		}
+
+	public:
+		property_container_t() {}
+		property_container_t(const property_container_t& other) { *this = other; }
+
+		property_container_t& operator=(const property_container_t& other)
+		{
+			if (this == &other) { return *this; }
+			m_properties.clear();
+			for (const auto& property : other.m_properties) { m_properties.emplace_back(property->clone()); }
+			m_size = other.m_size;
+			return *this;
+		}
+
+		std::size_t size() const { return m_size; }
+
+		/*
+		* Name: add
+		* Func: Add the attribute "name" with every value set to "value", and return its values.
+		* If the attribute already exists it's returned as is; it must have the same type.
+		* The returned reference stays valid until the attribute is removed.
+		*/
+		template<typename T>
+		std::vector<T>& add(const std::string& name, const T& value = T())
+		{
+			if (std::vector<T>* values = find<T>(name)) { return *values; }
+			assert(!find_base(name));
+
+			std::unique_ptr<property_t<T>> property(new property_t<T>());
+			property->name = name;
+			property->default_value = value;
+			property->values.assign(m_size, value);
+			std::vector<T>& values = property->values;
+			m_properties.push_back(std::move(property));
+			return values;
+		}
+
+		/*
+		* Name: find
+		* Func: Return the values of the attribute "name", or nullptr if there's no such attribute of type T.
+		*/
+		template<typename T>
+		std::vector<T>* find(const std::string& name)
+		{
+			property_t<T>* property = dynamic_cast<property_t<T>*>(find_base(name));
+			return property ? &property->values : nullptr;
+		}
+
+		template<typename T>
+		const std::vector<T>* find(const std::string& name) const
+		{
+			const property_t<T>* property = dynamic_cast<const property_t<T>*>(find_base(name));
+			return property ? &property->values : nullptr;
+		}
+
+		/*
+		* Name: remove
+		* Func: Remove the attribute "name". Return false if there's no such attribute.
+		*/
+		bool remove(const std::string& name)
+		{
+			for (auto it = m_properties.begin(); it != m_properties.end(); ++it) {
+				if ((*it)->name == name) {
+					m_properties.erase(it);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void resize(std::size_t n)
+		{
+			m_size = n;
+			for (const auto& property : m_properties) { property->resize(n); }
+		}
+
+		void permute(const std::vector<index_t>& permutation, std::size_t new_size)
+		{
+			m_size = new_size;
+			for (const auto& property : m_properties) { property->permute(permutation, new_size); }
+		}
+	};
+
+	/*
+	* Name: mesh_properties_t
+	* Func: Geometry and attributes of a trimesh_t, stored next to it as structures of arrays and indexed like its elements.
+	* Fill "positions", then call compute_face_normals/compute_vertex_normals in mesh_geometry.h.
+	* @Varia positions/vertex_normals: One vector per vertex.
+	* @Varia face_normals/face_areas: One unit normal and one area per face.
+	* @Varia vertex_attributes/face_attributes: User attributes.
+	*/
+	template<typename scalar_type>
+	struct mesh_properties_t
+	{
+		typedef scalar_type scalar_t;
+
+		soa3_t<scalar_t> positions;
+		soa3_t<scalar_t> vertex_normals;
+		soa3_t<scalar_t> face_normals;
+		std::vector<scalar_t> face_areas;
+		property_container_t vertex_attributes;
+		property_container_t face_attributes;
+
+		/*
+		* Name: resize
+		* Func: Give every property one value per element of the mesh. New values are zero (or the attribute default).
+		*/
+		void resize(const trimesh_t& mesh)
+		{
+			positions.resize(mesh.num_vertices());
+			vertex_normals.resize(mesh.num_vertices());
+			face_normals.resize(mesh.num_faces());
+			face_areas.resize(mesh.num_faces());
+			vertex_attributes.resize(mesh.num_vertices());
+			face_attributes.resize(mesh.num_faces());
+		}
+
+		/*
+		* Name: permute
+		* Func: Move the properties along with the elements after "reorder" or "garbage_collect" of the mesh.
+		*/
+		void permute(const permutation_t& permutation, const trimesh_t& mesh)
+		{
+			positions.permute(permutation.vertices, mesh.num_vertices());
+			vertex_normals.permute(permutation.vertices, mesh.num_vertices());
+			face_normals.permute(permutation.faces, mesh.num_faces());
+			permute_array(face_areas, permutation.faces, mesh.num_faces());
+			vertex_attributes.permute(permutation.vertices, mesh.num_vertices());
+			face_attributes.permute(permutation.faces, mesh.num_faces());
+		}
+	};
+}
+
+#endif // !__mesh_properties_h__
@@ -0,0 +1,147 @@
+#include"mesh_subdivision.h"
+#include"parallel.h"
+#include<cmath>
+#include<cassert>
+
+namespace trimesh
+{
+	namespace
+	{
+		const double pi = 3.14159265358979323846;
+
+		/*
+		* Name: sum_t
+		* Func: Weighted sum of positions, accumulated in double.
+		*/
+		struct sum_t
+		{
+			double x = 0, y = 0, z = 0;
+
+			template<typename scalar_t>
+			void add(const soa3_t<scalar_t>& p, index_t i, double weight)
+			{
+				x += weight * p.x[i];
+				y += weight * p.y[i];
+				z += weight * p.z[i];
+			}
+
+			template<typename scalar_t>
+			void store(soa3_t<scalar_t>& p, index_t i) const
+			{
+				p.x[i] = scalar_t(x);
+				p.y[i] = scalar_t(y);
+				p.z[i] = scalar_t(z);
+			}
+		};
+
+		/*
+		* Name: one_ring_t
+		* Func: The valence of a vertex, and its two neighbors along the boundary if it's a boundary vertex.
+		*/
+		struct one_ring_t
+		{
+			index_t valence = 0;
+			index_t boundary_next = -1, boundary_prev = -1;
+
+			one_ring_t(const trimesh_t& mesh, index_t v)
+			{
+				for (const index_t he_index : mesh.voh_range(v)) {
+					const trimesh_t::halfedge_t& he = mesh.halfedge(he_index);
+					if (he.face == -1) { boundary_next = he.vertex; }
+					if (mesh.halfedge(he.opposite).face == -1) { boundary_prev = he.vertex; }
+					++valence;
+				}
+			}
+
+			bool is_boundary() const { return boundary_next != -1; }
+		};
+	}
+
+	template<typename scalar_t>
+	void loop_subdivision(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, trimesh_t& refined, soa3_t<scalar_t>& refined_positions)
+	{
+		assert(positions.size() == std::size_t(mesh.num_vertices()));
+		const index_t num_vertices = mesh.num_vertices(), num_edges = mesh.num_edges();
+		mesh.loop_refine(refined);
+		refined_positions.resize(num_vertices + num_edges);
+
+		parallel_for(0, num_vertices, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t v = begin; v < end; ++v) {
+				const one_ring_t ring(mesh, v);
+				sum_t sum;
+				if (ring.is_boundary()) {
+					sum.add(positions, v, 0.75);
+					sum.add(positions, ring.boundary_next, 0.125);
+					sum.add(positions, ring.boundary_prev, 0.125);
+				}
+				else if (ring.valence == 0) {
+					sum.add(positions, v, 1.0);
+				}
+				else {
+					const double n = double(ring.valence), c = 0.375 + 0.25 * std::cos(2 * pi / n);
+					const double beta = (0.625 - c * c) / n;
+					sum.add(positions, v, 1 - n * beta);
+					for (const index_t neighbor : mesh.vv_range(v)) { sum.add(positions, neighbor, beta); }
+				}
+				sum.store(refined_positions, v);
+			}
+		});
+
+		parallel_for(0, num_edges, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t e = begin; e < end; ++e) {
+				const trimesh_t::halfedge_t& he = mesh.halfedge(mesh.edge_halfedge(e));
+				const trimesh_t::halfedge_t& opposite = mesh.halfedge(he.opposite);
+				sum_t sum;
+				if (he.face == -1 || opposite.face == -1) {
+					sum.add(positions, he.vertex, 0.5);
+					sum.add(positions, opposite.vertex, 0.5);
+				}
+				else {
+					sum.add(positions, he.vertex, 0.375);
+					sum.add(positions, opposite.vertex, 0.375);
+					sum.add(positions, mesh.halfedge(he.next).vertex, 0.125);
+					sum.add(positions, mesh.halfedge(opposite.next).vertex, 0.125);
+				}
+				sum.store(refined_positions, num_vertices + e);
+			}
+		});
+	}
+
+	template<typename scalar_t>
+	void sqrt3_subdivision(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, trimesh_t& refined, soa3_t<scalar_t>& refined_positions)
+	{
+		assert(positions.size() == std::size_t(mesh.num_vertices()));
+		const index_t num_vertices = mesh.num_vertices(), num_faces = mesh.num_faces();
+		mesh.sqrt3_refine(refined);
+		refined_positions.resize(num_vertices + num_faces);
+
+		parallel_for(0, num_vertices, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t v = begin; v < end; ++v) {
+				const one_ring_t ring(mesh, v);
+				sum_t sum;
+				if (ring.is_boundary() || ring.valence == 0) {
+					sum.add(positions, v, 1.0);
+				}
+				else {
+					const double n = double(ring.valence), alpha = (4 - 2 * std::cos(2 * pi / n)) / 9;
+					sum.add(positions, v, 1 - alpha);
+					for (const index_t neighbor : mesh.vv_range(v)) { sum.add(positions, neighbor, alpha / n); }
+				}
+				sum.store(refined_positions, v);
+			}
+		});
+
+		parallel_for(0, num_faces, mesh.num_threads(), [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t f = begin; f < end; ++f) {
+				sum_t sum;
+				for (const index_t v : mesh.fv_range(f)) { sum.add(positions, v, 1.0 / 3); }
+				sum.store(refined_positions, num_vertices + f);
+			}
+		});
+	}
+
+	template void loop_subdivision<float>(const trimesh_t&, const soa3_t<float>&, trimesh_t&, soa3_t<float>&);
+	template void loop_subdivision<double>(const trimesh_t&, const soa3_t<double>&, trimesh_t&, soa3_t<double>&);
+	template void sqrt3_subdivision<float>(const trimesh_t&, const soa3_t<float>&, trimesh_t&, soa3_t<float>&);
+	template void sqrt3_subdivision<double>(const trimesh_t&, const soa3_t<double>&, trimesh_t&, soa3_t<double>&);
+}
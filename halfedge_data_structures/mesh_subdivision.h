@@ -0,0 +1,31 @@
+#ifndef __mesh_subdivision_h__
+#define __mesh_subdivision_h__
+
+#include"trimesh.h"
+#include"mesh_properties.h"
+
+namespace trimesh
+{
+	/*
+	* Name: loop_subdivision
+	* Func: One step of Loop subdivision: split every triangle in 4 with "loop_refine", then smooth the positions.
+	* An old vertex moves to (1 - n * beta) * p + beta * (sum of its n neighbors), with Loop's beta, and the middle of an edge (a, b)
+	* with the opposite vertices c and d is 3/8 (a + b) + 1/8 (c + d). On the boundary the curve rules are used instead:
+	* 3/4 p + 1/8 (sum of the 2 boundary neighbors) and (a + b) / 2.
+	* Each new position only reads the old mesh, so the positions are computed on the threads of the mesh.
+	* Instantiated for float and double.
+	*/
+	template<typename scalar_t>
+	void loop_subdivision(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, trimesh_t& refined, soa3_t<scalar_t>& refined_positions);
+
+	/*
+	* Name: sqrt3_subdivision
+	* Func: One step of sqrt(3) subdivision (Kobbelt 2000): insert the center of each face and flip the old edges with "sqrt3_refine".
+	* An interior vertex moves to (1 - alpha) * p + alpha / n * (sum of its n neighbors), alpha = (4 - 2 cos(2 pi / n)) / 9.
+	* Boundary edges aren't subdivided, so the boundary vertices stay fixed.
+	*/
+	template<typename scalar_t>
+	void sqrt3_subdivision(const trimesh_t& mesh, const soa3_t<scalar_t>& positions, trimesh_t& refined, soa3_t<scalar_t>& refined_positions);
+}
+
+#endif // !__mesh_subdivision_h__
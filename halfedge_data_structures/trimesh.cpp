@@ -1,7 +1,9 @@
 #include"trimesh.h"
+#include"parallel.h"
 #include<iostream>
 #include<cassert>
 #include<set>
+#include<algorithm>
 
 namespace trimesh
 {
@@ -25,6 +27,11 @@ namespace trimesh
 		}
 	}
 
+	void trimesh_t::set_num_threads(unsigned num_threads)
+	{
+		m_num_threads = resolve_num_threads(num_threads);
+	}
+
 	void trimesh_t::clear()
 	{
 		m_halfedges.clear();
@@ -32,151 +39,573 @@ namespace trimesh
 		m_face_halfedges.clear();
 		m_edge_halfedges.clear();
 		m_edge2halfedge.clear();
+		m_mapping.reset();
+		m_vertex_deleted.clear();
+		m_face_deleted.clear();
+		m_edge_deleted.clear();
+	}
+
+	void trimesh_t::detach()
+	{
+		m_halfedges.detach();
+		m_vertex_halfedges.detach();
+		m_face_halfedges.detach();
+		m_edge_halfedges.detach();
+		m_edge2halfedge.detach();
+		m_mapping.reset();
 	}
 
 	void trimesh_t::build(number_t num_vertices, number_t num_triangles, const trimesh::triangle_t* triangles, number_t num_edges, const trimesh::edge_t* edges)
 	{
 		assert(triangles);
 		assert(edges);
+		assert(num_vertices <= (1ul << 32));  // Vertex indices must fit into half of the edge key.
 
 		clear();
 		m_vertex_halfedges.resize(num_vertices, -1);
 		m_face_halfedges.resize(num_triangles, -1);
 		m_edge_halfedges.resize(num_edges, -1);
-		m_halfedges.reserve(num_edges * 2);  // Change capacity instead of size.
+		m_halfedges.resize(num_edges * 2);
+		m_edge2halfedge.resize(num_edges * 2);
 
-		// Record (vertex[i], vertex[j]) -> face index, used later.
-		// The same face index per triangle.
-		edge2index_t edge2fi;
-		for (int i = 0; i < num_triangles; ++i) {
-			const triangle_t& tri = triangles[i];
-			edge2fi[std::make_pair(tri.i(), tri.j())] = i;
-			edge2fi[std::make_pair(tri.j(), tri.k())] = i;
-			edge2fi[std::make_pair(tri.k(), tri.i())] = i;
-		}
-
-		for (int i = 0; i < num_edges; ++i) {
-			// Split edge into halfedges he0 and he1.
-			// Fill "m_halfedges".
-			const edge_t& edge = edges[i];
-
-			const index_t he0_index = m_halfedges.size();
-			m_halfedges.push_back(halfedge_t());
-			halfedge_t& he0 = m_halfedges.back();
-
-			const index_t he1_index = m_halfedges.size();
-			m_halfedges.push_back(halfedge_t());
-			halfedge_t& he1 = m_halfedges.back();
-
-			// Fill the member variables (except for next) of he0 and he1.
-			// The vertex order of the key of "edge2fi" is according to initialization.
-			// While the vertex order of 'edge' is (min_vi, max_vi), according to the function "triangles2edges".
-			he0.face = halfedge2face(edge2fi, edge.start(), edge.end());
-			he0.vertex = edge.end();  // he0 points to the max_vi
-			he0.edge = i;
-			he0.opposite = he1_index;
-			
-			he1.face = halfedge2face(edge2fi, edge.end(), edge.start());
-			he1.vertex = edge.start();  // he1 points to the min_vi
-			he1.edge = i;
-			he1.opposite = he0_index;
-
-			// Fill "m_edge2halfedge", (vertex_index_i, vertex_index_j) -> halfedge_index.
-			assert(m_edge2halfedge.find(std::make_pair(edge.start(), edge.end())) == m_edge2halfedge.end());
-			assert(m_edge2halfedge.find(std::make_pair(edge.end(), edge.start())) == m_edge2halfedge.end());
-			m_edge2halfedge[std::make_pair(edge.start(), edge.end())] = he0_index;
-			m_edge2halfedge[std::make_pair(edge.end(), edge.start())] = he1_index;
-
-			// Fill "m_vertex_halfedges"each vertex stores one of outgoing halfedges.
-			if (m_vertex_halfedges[he0.vertex] == -1 || he1.face == -1) {
-				m_vertex_halfedges[he0.vertex] = he0.opposite;
-			}
-			if (m_vertex_halfedges[he1.vertex] == -1 || he0.face == -1) {
-				m_vertex_halfedges[he1.vertex] = he1.opposite;
-			}
-
-			// Fill "m_face_halfedges"each face stores one of halfedges.
-			if (he0.face != -1 && he1.face != -1) {
-				if (m_face_halfedges[he0.face] == -1) {
-					m_face_halfedges[he0.face] = he0_index;
+		// Split each edge into halfedges he0 and he1, allocated as a consecutive pair.
+		// The vertex order of 'edge' is (min_vi, max_vi), according to the function "triangles2edges".
+		parallel_for(0, num_edges, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (index_t i = index_t(begin); i < index_t(end); ++i) {
+				const edge_t& edge = edges[i];
+				const index_t he0_index = 2 * i;
+				const index_t he1_index = 2 * i + 1;
+
+				halfedge_t& he0 = m_halfedges[he0_index];
+				he0.vertex = edge.end();  // he0 points to the max_vi
+				he0.edge = i;
+				he0.opposite = he1_index;
+
+				halfedge_t& he1 = m_halfedges[he1_index];
+				he1.vertex = edge.start();  // he1 points to the min_vi
+				he1.edge = i;
+				he1.opposite = he0_index;
+
+				// Fill "m_edge2halfedge", (vertex_index_i, vertex_index_j) -> halfedge_index.
+				m_edge2halfedge[he0_index].key = pack_edge(edge.start(), edge.end());
+				m_edge2halfedge[he0_index].index = he0_index;
+				m_edge2halfedge[he1_index].key = pack_edge(edge.end(), edge.start());
+				m_edge2halfedge[he1_index].index = he1_index;
+
+				// Fill "m_edge_halfedges", each edge stores he0_index.
+				m_edge_halfedges[i] = he0_index;
+			}
+		});
+
+		// Record (vertex[i], vertex[j]) -> corner index 3 * face + c, used later.
+		// The key of corner c is the directed edge from vertex c to vertex c + 1 of the triangle.
+		edge2index_t corners(num_triangles * 3);
+		parallel_for(0, num_triangles, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (index_t i = index_t(begin); i < index_t(end); ++i) {
+				const triangle_t& tri = triangles[i];
+				corners[3 * i + 0].key = pack_edge(tri.i(), tri.j());
+				corners[3 * i + 1].key = pack_edge(tri.j(), tri.k());
+				corners[3 * i + 2].key = pack_edge(tri.k(), tri.i());
+				corners[3 * i + 0].index = 3 * i + 0;
+				corners[3 * i + 1].index = 3 * i + 1;
+				corners[3 * i + 2].index = 3 * i + 2;
+			}
+		});
+
+		edge2index_t buffer(std::max(corners.size(), m_edge2halfedge.size()));
+		sort_edge_keys(m_edge2halfedge.data(), m_edge2halfedge.size(), buffer, m_num_threads);
+		sort_edge_keys(corners.data(), corners.size(), buffer, m_num_threads);
+
+		std::vector<index_t> corner2he;
+		build_corners(corners, corner2he);
+		build_links(num_triangles, corner2he);
+	}
+
+	void trimesh_t::build_from_triangles(number_t num_vertices, number_t num_triangles, const trimesh::triangle_t* triangles)
+	{
+		assert(triangles);
+		assert(num_vertices <= (1ul << 32));
+
+		clear();
+		m_vertex_halfedges.resize(num_vertices, -1);
+		m_face_halfedges.resize(num_triangles, -1);
+
+		// Record (min_vi, max_vi) -> corner index 3 * face + c for every corner of every triangle.
+		// After sorting, all the corners of the same edge are consecutive and the edges appear in (min_vi, max_vi) order.
+		edge2index_t corners(num_triangles * 3);
+		parallel_for(0, num_triangles, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (index_t i = index_t(begin); i < index_t(end); ++i) {
+				const triangle_t& tri = triangles[i];
+				const index_t vertex[3] = { tri.i(), tri.j(), tri.k() };
+				for (int c = 0; c < 3; ++c) {
+					const index_t vi = vertex[c], vj = vertex[(c + 1) % 3];
+					corners[3 * i + c].key = pack_edge(std::min(vi, vj), std::max(vi, vj));
+					corners[3 * i + c].index = 3 * i + c;
+				}
+			}
+		});
+
+		edge2index_t buffer(corners.size());
+		sort_edge_keys(corners.data(), corners.size(), buffer, m_num_threads);
+
+		// Each run of equal keys is an edge. Number the edges by counting the runs starting in each chunk.
+		// A chunk owns the runs starting in it, even if they extend into the next chunk.
+		const unsigned num_threads = m_num_threads;
+		auto is_run_start = [&](std::size_t k) { return k == 0 || corners[k].key != corners[k - 1].key; };
+		std::vector<index_t> first_edge(num_threads + 1, 0);
+		parallel_for(0, corners.size(), num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+			for (std::size_t k = begin; k < end; ++k) {
+				if (is_run_start(k)) { ++first_edge[t + 1]; }
+			}
+		});
+		for (unsigned t = 0; t < num_threads; ++t) {
+			first_edge[t + 1] += first_edge[t];
+		}
+
+		const index_t num_edges = first_edge[num_threads];
+		m_halfedges.resize(num_edges * 2);
+		m_edge_halfedges.resize(num_edges);
+		m_edge2halfedge.resize(num_edges * 2);
+
+		// Split each edge into halfedges he0 (min_vi -> max_vi) and he1 (max_vi -> min_vi).
+		// As in "build", the face of a halfedge shared by several triangles is the last of them.
+		std::vector<index_t> corner2he(corners.size(), -1);
+		parallel_for(0, corners.size(), num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+			index_t edge = first_edge[t];
+			std::size_t k = begin;
+			while (k < end && !is_run_start(k)) { ++k; }
+			while (k < end) {
+				const std::uint64_t key = corners[k].key;
+				const index_t vmin = key >> 32, vmax = key & 0xffffffff;
+				const index_t he0_index = 2 * edge;
+				const index_t he1_index = 2 * edge + 1;
+
+				halfedge_t& he0 = m_halfedges[he0_index];
+				he0.vertex = vmax;
+				he0.edge = edge;
+				he0.opposite = he1_index;
+
+				halfedge_t& he1 = m_halfedges[he1_index];
+				he1.vertex = vmin;
+				he1.edge = edge;
+				he1.opposite = he0_index;
+
+				m_edge_halfedges[edge] = he0_index;
+
+				// Fill "m_edge2halfedge", (vertex_index_i, vertex_index_j) -> halfedge_index.
+				m_edge2halfedge[he0_index].key = pack_edge(vmin, vmax);
+				m_edge2halfedge[he0_index].index = he0_index;
+				m_edge2halfedge[he1_index].key = pack_edge(vmax, vmin);
+				m_edge2halfedge[he1_index].index = he1_index;
+
+				for (; k < corners.size() && corners[k].key == key; ++k) {
+					const index_t corner = corners[k].index;
+					const triangle_t& tri = triangles[corner / 3];
+					const index_t origin = corner % 3 == 0 ? tri.i() : (corner % 3 == 1 ? tri.j() : tri.k());
+					const index_t he_index = origin == vmin ? he0_index : he1_index;
+					corner2he[corner] = he_index;
+					m_halfedges[he_index].face = corner / 3;
 				}
-				if (m_face_halfedges[he1.face] == -1) {
-					m_face_halfedges[he1.face] = he1_index;
+				++edge;
+			}
+		});
+
+		sort_edge_keys(m_edge2halfedge.data(), m_edge2halfedge.size(), buffer, m_num_threads);
+		build_links(num_triangles, corner2he);
+	}
+
+	void trimesh_t::sort_edge_keys(edge_key_t* keys, std::size_t n, edge2index_t& buffer, unsigned num_threads)
+	{
+		if (n < 2) { return; }
+		buffer.resize(std::max(buffer.size(), n));
+
+		// count[t][d]: the number of keys with digit d in the chunk of thread t, then the scatter position of the first of them.
+		// Positions are assigned digit by digit and thread by thread within a digit, which keeps the sort stable.
+		const std::size_t radix = 1 << 16;
+		edge_key_t* src = keys;
+		edge_key_t* dst = &buffer[0];
+		std::vector<std::vector<std::size_t>> count(num_threads, std::vector<std::size_t>(radix));
+		for (int shift = 0; shift < 64; shift += 16) {
+			parallel_for(0, n, num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+				std::vector<std::size_t>& c = count[t];
+				std::fill(c.begin(), c.end(), 0);
+				for (std::size_t i = begin; i < end; ++i) {
+					++c[(src[i].key >> shift) & 0xffff];
+				}
+			});
+
+			// All keys share this digit, so the pass wouldn't move anything.
+			const std::size_t digit0 = (src[0].key >> shift) & 0xffff;
+			std::size_t same = 0;
+			for (unsigned t = 0; t < num_threads; ++t) { same += count[t][digit0]; }
+			if (same == n) { continue; }
+
+			std::size_t sum = 0;
+			for (std::size_t d = 0; d < radix; ++d) {
+				for (unsigned t = 0; t < num_threads; ++t) {
+					const std::size_t c = count[t][d];
+					count[t][d] = sum;
+					sum += c;
 				}
 			}
+			parallel_for(0, n, num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+				std::vector<std::size_t>& c = count[t];
+				for (std::size_t i = begin; i < end; ++i) {
+					dst[c[(src[i].key >> shift) & 0xffff]++] = src[i];
+				}
+			});
+			std::swap(src, dst);
+		}
 
-			// Fill "m_edge_halfedges", each edge stores he0_index.
-			assert(m_edge_halfedges[i] == -1);
-			m_edge_halfedges[i] = he0_index;
+		if (src != keys) {
+			std::copy(src, src + n, keys);
 		}
+	}
 
-		// Fill "next" halfedge of each halfedge.
-		// Handle the boundary halfedge separately.
-		std::vector<index_t> boundary_he;
-		for (int i = 0; i < m_halfedges.size(); ++i) {
-			halfedge_t& he = m_halfedges[i];
-			if (he.face == -1) {
-				boundary_he.push_back(i);
-				continue;
+	trimesh_t::index_t trimesh_t::find_edge_key(const edge_key_t* keys, std::size_t n, std::uint64_t key)
+	{
+		const edge_key_t* it = std::lower_bound(keys, keys + n, key,
+			[](const edge_key_t& a, std::uint64_t b) { return a.key < b; });
+		if (it == keys + n || it->key != key) { return -1; }
+		return it - keys;
+	}
+
+	void trimesh_t::build_corners(edge2index_t& corners, std::vector<index_t>& corner2he)
+	{
+		corner2he.assign(corners.size(), -1);
+
+		// Merge the two sorted arrays. If several triangles share the same directed edge (non-manifold),
+		// the halfedge belongs to the last of them, since the radix sort is stable.
+		// The keys of "m_edge2halfedge" are unique, so each chunk of it owns the corners it matches.
+		parallel_for(0, m_edge2halfedge.size(), m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			if (begin == end) { return; }
+			std::size_t c = std::lower_bound(corners.begin(), corners.end(), m_edge2halfedge[begin].key,
+				[](const edge_key_t& a, std::uint64_t b) { return a.key < b; }) - corners.begin();
+			for (std::size_t k = begin; k < end; ++k) {
+				const edge_key_t& e2h = m_edge2halfedge[k];
+				assert(k == 0 || m_edge2halfedge[k - 1].key != e2h.key);
+
+				while (c < corners.size() && corners[c].key < e2h.key) { ++c; }
+				while (c < corners.size() && corners[c].key == e2h.key) {
+					corner2he[corners[c].index] = e2h.index;
+					m_halfedges[e2h.index].face = corners[c].index / 3;
+					++c;
+				}
 			}
-			const triangle_t& tri = triangles[he.face];
-			const index_t vertex = he.vertex;
-			
-			index_t temp = -1;
-			if (tri.i() == vertex) {
-				temp = tri.j();
+		});
+	}
+
+	void trimesh_t::build_links(number_t num_triangles, const std::vector<index_t>& corner2he)
+	{
+		// Fill "m_vertex_halfedges", each vertex stores one of outgoing halfedges.
+		// The outgoing halfedges of a vertex are consecutive in "m_edge2halfedge", a chunk owns the vertices starting in it.
+		// Prefer the last outgoing boundary halfedge, so that traversal starts at the boundary.
+		const std::size_t num_keys = m_edge2halfedge.size();
+		auto origin_of = [&](std::size_t k) { return m_edge2halfedge[k].key >> 32; };
+		parallel_for(0, num_keys, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			std::size_t k = begin;
+			while (k < end && k > 0 && origin_of(k) == origin_of(k - 1)) { ++k; }
+			while (k < end) {
+				const std::uint64_t origin = origin_of(k);
+				index_t first = -1, boundary = -1;
+				for (; k < num_keys && origin_of(k) == origin; ++k) {
+					const index_t he_index = m_edge2halfedge[k].index;
+					if (first == -1 || he_index < first) { first = he_index; }
+					if (m_halfedges[he_index].face == -1 && he_index > boundary) { boundary = he_index; }
+				}
+				m_vertex_halfedges[origin] = boundary != -1 ? boundary : first;
 			}
-			else if (tri.j() == vertex) {
-				temp = tri.k();
+		});
+
+		// Fill "m_face_halfedges", each face stores its first halfedge lying on an interior edge,
+		// or its first halfedge if the face has no interior edge.
+		// Fill "next" halfedge of each interior halfedge within the same face.
+		parallel_for(0, num_triangles, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (index_t i = index_t(begin); i < index_t(end); ++i) {
+				index_t first = -1;
+				for (int c = 0; c < 3; ++c) {
+					const index_t he_index = corner2he[3 * i + c];
+					if (he_index == -1 || m_halfedges[he_index].face != i) { continue; }
+
+					halfedge_t& he = m_halfedges[he_index];
+					he.next = corner2he[3 * i + (c + 1) % 3];
+					if (first == -1 || he_index < first) { first = he_index; }
+					if (m_halfedges[he.opposite].face != -1) {
+						if (m_face_halfedges[i] == -1 || he_index < m_face_halfedges[i]) {
+							m_face_halfedges[i] = he_index;
+						}
+					}
+				}
+				if (m_face_halfedges[i] == -1) { m_face_halfedges[i] = first; }
 			}
-			else if (tri.k() == vertex) {
-				temp = tri.i();
+		});
+
+		// Handle the boundary halfedge separately.
+		// Collect the boundary halfedges in ascending index order.
+		std::vector<std::vector<index_t>> chunk_boundary(m_num_threads);
+		parallel_for(0, m_halfedges.size(), m_num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				if (m_halfedges[i].face == -1) { chunk_boundary[t].push_back(i); }
 			}
-			assert(temp != -1);
+		});
+		std::vector<index_t> boundary_he;
+		for (unsigned t = 0; t < m_num_threads; ++t) {
+			boundary_he.insert(boundary_he.end(), chunk_boundary[t].begin(), chunk_boundary[t].end());
+		}
 
-			he.next = m_edge2halfedge[std::make_pair(vertex, temp)];
+		// Bucket the outgoing boundary halfedges by origin vertex (counting sort), keeping ascending index order.
+		const std::size_t num_vertices = m_vertex_halfedges.size();
+		std::vector<index_t> offsets(num_vertices + 1, 0);
+		for (auto it = boundary_he.begin(); it != boundary_he.end(); ++it) {
+			++offsets[m_halfedges[m_halfedges[*it].opposite].vertex + 1];
+		}
+		for (std::size_t v = 0; v < num_vertices; ++v) {
+			offsets[v + 1] += offsets[v];
 		}
 
-		// vertex2outgoing_boundary_halfedge_index: vertex index -> all of outgoing boundary halfedges indices.
-		std::map<index_t, std::set<index_t>> vertex2outgoing_boundary_halfedge_index;
+		std::vector<index_t> outgoing(boundary_he.size());
+		std::vector<index_t> cursor(offsets.begin(), offsets.end() - 1);
 		for (auto it = boundary_he.begin(); it != boundary_he.end(); ++it) {
-			halfedge_t& he = m_halfedges[*it];
-			const index_t origin = m_halfedges[he.opposite].vertex;  // The index of origin vertex of boundary halfedge.
-			vertex2outgoing_boundary_halfedge_index[origin].insert(*it);
+			outgoing[cursor[m_halfedges[m_halfedges[*it].opposite].vertex]++] = *it;
 		}
 
 		// For each boundary halfedge, make its next halfedge one of the boundary halfedges
-		// originating at its "vertex" (pointing at).
+		// originating at its "vertex" (pointing at), taking each of them once.
+		std::copy(offsets.begin(), offsets.end() - 1, cursor.begin());
 		for (auto it = boundary_he.begin(); it != boundary_he.end(); ++it) {
 			halfedge_t& he = m_halfedges[*it];
-			std::set<index_t>& outgoing = vertex2outgoing_boundary_halfedge_index[he.vertex];
-			if (!outgoing.empty()) {
-				auto iter = outgoing.begin();
-				he.next = *iter;
-				outgoing.erase(iter);
+			if (cursor[he.vertex] < offsets[he.vertex + 1]) {
+				he.next = outgoing[cursor[he.vertex]++];
 			}
 		}
 	}
 
-	index_t trimesh_t::halfedge2face(const edge2index_t& edge2fi, index_t vertex_i, index_t vertex_j)
+	trimesh_t::index_t trimesh_t::find_halfedge(index_t vertex_i, index_t vertex_j) const
 	{
-		assert(!edge2fi.empty());
-		// If no such edge exists, then there's no such face in the mesh.
-		// The edge must be a boundary edge.
-		auto it = edge2fi.find(std::make_pair(vertex_i, vertex_j));
-		if (it == edge2fi.end()) { return -1; }
-		return it->second;
+		// The lookup is dropped by the topology operators.
+		if (m_edge2halfedge.size() != m_halfedges.size()) {
+			for (const index_t he_index : voh_range(vertex_i)) {
+				if (m_halfedges[he_index].vertex == vertex_j) { return he_index; }
+			}
+			return -1;
+		}
+
+		const index_t k = find_edge_key(m_edge2halfedge.data(), m_edge2halfedge.size(), pack_edge(vertex_i, vertex_j));
+		if (k == -1) { return -1; }
+		return m_edge2halfedge[k].index;
+	}
+
+	trimesh_t::index_t trimesh_t::halfedge2face(index_t vertex_i, index_t vertex_j) const
+	{
+		// If no such halfedge exists, then there's no such face in the mesh.
+		const index_t he_index = find_halfedge(vertex_i, vertex_j);
+		if (he_index == -1) { return -1; }
+		return m_halfedges[he_index].face;
 	}
 
 	void trimesh_t::vv_neighbors(const index_t index, std::vector<index_t>& neighbors) const
 	{
 		neighbors.clear();
-		index_t he_index = m_vertex_halfedges[index];
-		const index_t hstop = he_index;
-		do {
-			const halfedge_t& he = m_halfedges[he_index];
-			neighbors.push_back(he.vertex);
-			he_index = m_halfedges[he.opposite].next;
-		} while (he_index != hstop);
+		for (const index_t vertex : vv_range(index)) {
+			neighbors.push_back(vertex);
+		}
+	}
+
+	void trimesh_t::vertex_adjacency(csr_t& vv, csr_t& vf) const
+	{
+		const std::size_t num_vertices = m_vertex_halfedges.size();
+		vv.offsets.assign(num_vertices + 1, 0);
+		vf.offsets.assign(num_vertices + 1, 0);
+
+		// Count the one-ring neighbors and incident faces of each vertex.
+		// A boundary vertex has one more neighbor than faces.
+		parallel_for(0, num_vertices, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				index_t num_neighbors = 0, num_faces = 0;
+				for (const index_t he_index : voh_range(i)) {
+					++num_neighbors;
+					if (m_halfedges[he_index].face != -1) { ++num_faces; }
+				}
+				vv.offsets[i + 1] = num_neighbors;
+				vf.offsets[i + 1] = num_faces;
+			}
+		});
+
+		for (std::size_t i = 0; i < num_vertices; ++i) {
+			vv.offsets[i + 1] += vv.offsets[i];
+			vf.offsets[i + 1] += vf.offsets[i];
+		}
+
+		// Each vertex fills its own rows.
+		vv.indices.resize(vv.offsets[num_vertices]);
+		vf.indices.resize(vf.offsets[num_vertices]);
+		parallel_for(0, num_vertices, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				index_t* vv_row = vv.indices.data() + vv.offsets[i];
+				index_t* vf_row = vf.indices.data() + vf.offsets[i];
+				for (const index_t he_index : voh_range(i)) {
+					const halfedge_t& he = m_halfedges[he_index];
+					*vv_row++ = he.vertex;
+					if (he.face != -1) { *vf_row++ = he.face; }
+				}
+			}
+		});
+	}
+
+	void trimesh_t::reorder(permutation_t& permutation)
+	{
+		assert(m_vertex_deleted.empty() && m_face_deleted.empty() && m_edge_deleted.empty());  // Call "garbage_collect" first.
+		detach();
+
+		const index_t num_vertices = m_vertex_halfedges.size();
+		const index_t num_faces = m_face_halfedges.size();
+		const index_t num_edges = m_edge_halfedges.size();
+		const index_t num_halfedges = m_halfedges.size();
+
+		// Vertices: reverse Cuthill-McKee. Breadth-first search started from a vertex of minimal degree in each component,
+		// visiting the neighbors of each vertex by increasing degree.
+		csr_t vv, vf;
+		vertex_adjacency(vv, vf);
+		auto degree = [&](index_t v) { return vv.offsets[v + 1] - vv.offsets[v]; };
+
+		std::vector<index_t> order;  // order[new_index] = old_index
+		order.reserve(num_vertices);
+		std::vector<index_t> by_degree(num_vertices);
+		for (index_t v = 0; v < num_vertices; ++v) { by_degree[v] = v; }
+		std::stable_sort(by_degree.begin(), by_degree.end(), [&](index_t a, index_t b) { return degree(a) < degree(b); });
+
+		std::vector<char> visited(num_vertices, 0);
+		for (auto it = by_degree.begin(); it != by_degree.end(); ++it) {
+			if (visited[*it]) { continue; }
+			visited[*it] = 1;
+			std::size_t head = order.size();
+			order.push_back(*it);
+			while (head < order.size()) {
+				const index_t v = order[head++];
+				const std::size_t first = order.size();
+				for (index_t k = vv.offsets[v]; k < vv.offsets[v + 1]; ++k) {
+					const index_t u = vv.indices[k];
+					if (!visited[u]) {
+						visited[u] = 1;
+						order.push_back(u);
+					}
+				}
+				std::stable_sort(order.begin() + first, order.end(), [&](index_t a, index_t b) { return degree(a) < degree(b); });
+			}
+		}
+		std::reverse(order.begin(), order.end());
+
+		permutation.vertices.resize(num_vertices);
+		for (index_t i = 0; i < num_vertices; ++i) {
+			permutation.vertices[order[i]] = i;
+		}
+
+		// Faces: counting sort by the smallest new index of their vertices, stable in the old order.
+		std::vector<index_t> offsets(num_vertices + 1, 0);
+		std::vector<index_t> face_key(num_faces, -1);
+		for (index_t f = 0; f < num_faces; ++f) {
+			for (const index_t v : fv_range(f)) {
+				const index_t key = permutation.vertices[v];
+				if (face_key[f] == -1 || key < face_key[f]) { face_key[f] = key; }
+			}
+			++offsets[face_key[f] + 1];
+		}
+		for (index_t v = 0; v < num_vertices; ++v) {
+			offsets[v + 1] += offsets[v];
+		}
+		permutation.faces.resize(num_faces);
+		for (index_t f = 0; f < num_faces; ++f) {
+			permutation.faces[f] = offsets[face_key[f]]++;
+		}
+
+		// Edges: in the order they're first met walking the faces in their new order.
+		// Edges without any face keep their relative order at the end.
+		std::vector<index_t> face_order(num_faces);
+		for (index_t f = 0; f < num_faces; ++f) {
+			face_order[permutation.faces[f]] = f;
+		}
+		permutation.edges.assign(num_edges, -1);
+		index_t next_edge = 0;
+		for (auto it = face_order.begin(); it != face_order.end(); ++it) {
+			for (const index_t e : fe_range(*it)) {
+				if (permutation.edges[e] == -1) { permutation.edges[e] = next_edge++; }
+			}
+		}
+		for (index_t e = 0; e < num_edges; ++e) {
+			if (permutation.edges[e] == -1) { permutation.edges[e] = next_edge++; }
+		}
+
+		// Halfedges: follow their edge, keeping he0/he1 inside the pair.
+		permutation.halfedges.resize(num_halfedges);
+		for (index_t h = 0; h < num_halfedges; ++h) {
+			permutation.halfedges[h] = 2 * permutation.edges[h >> 1] + (h & 1);
+		}
+
+		apply_permutation(permutation, num_vertices, num_faces, num_edges);
+	}
+
+	void trimesh_t::apply_permutation(const permutation_t& permutation, index_t num_vertices, index_t num_faces, index_t num_edges)
+	{
+		const permutation_t& p = permutation;
+		auto remap = [](const std::vector<index_t>& perm, index_t index) { return index == -1 ? -1 : perm[index]; };
+
+		std::vector<halfedge_t> halfedges(2 * num_edges);
+		parallel_for(0, m_halfedges.size(), m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t h = begin; h < end; ++h) {
+				if (p.halfedges[h] == -1) { continue; }
+				const halfedge_t& he = m_halfedges[h];
+				halfedge_t& new_he = halfedges[p.halfedges[h]];
+				new_he.vertex = remap(p.vertices, he.vertex);
+				new_he.face = remap(p.faces, he.face);
+				new_he.edge = remap(p.edges, he.edge);
+				new_he.next = remap(p.halfedges, he.next);
+				new_he.opposite = remap(p.halfedges, he.opposite);
+			}
+		});
+		m_halfedges.swap(halfedges);
+
+		std::vector<index_t> vertex_halfedges(num_vertices);
+		for (std::size_t v = 0; v < m_vertex_halfedges.size(); ++v) {
+			if (p.vertices[v] != -1) { vertex_halfedges[p.vertices[v]] = remap(p.halfedges, m_vertex_halfedges[v]); }
+		}
+		m_vertex_halfedges.swap(vertex_halfedges);
+
+		std::vector<index_t> face_halfedges(num_faces);
+		for (std::size_t f = 0; f < m_face_halfedges.size(); ++f) {
+			if (p.faces[f] != -1) { face_halfedges[p.faces[f]] = remap(p.halfedges, m_face_halfedges[f]); }
+		}
+		m_face_halfedges.swap(face_halfedges);
+
+		std::vector<index_t> edge_halfedges(num_edges);
+		for (std::size_t e = 0; e < m_edge_halfedges.size(); ++e) {
+			if (p.edges[e] != -1) { edge_halfedges[p.edges[e]] = remap(p.halfedges, m_edge_halfedges[e]); }
+		}
+		m_edge_halfedges.swap(edge_halfedges);
+
+		m_vertex_deleted.clear();
+		m_face_deleted.clear();
+		m_edge_deleted.clear();
+
+		// The keys change with the vertex indices, so "m_edge2halfedge" is rebuilt.
+		build_edge_lookup();
+	}
+
+	void trimesh_t::fill_edge_lookup(edge_key_t* keys) const
+	{
+		const std::size_t num_halfedges = m_halfedges.size();
+		parallel_for(0, num_halfedges, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t h = begin; h < end; ++h) {
+				keys[h].key = pack_edge(m_halfedges[m_halfedges[h].opposite].vertex, m_halfedges[h].vertex);
+				keys[h].index = h;
+			}
+		});
+		edge2index_t buffer(num_halfedges);
+		sort_edge_keys(keys, num_halfedges, buffer, m_num_threads);
+	}
+
+	void trimesh_t::build_edge_lookup()
+	{
+		m_edge2halfedge.resize(m_halfedges.size());
+		fill_edge_lookup(m_edge2halfedge.data());
 	}
 }
\ No newline at end of file
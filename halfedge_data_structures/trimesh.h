@@ -2,12 +2,37 @@
 #define __trimesh_h__
 
 #include"trimesh_types.h"
+#include"array.h"
 #include<vector>
-#include<map>
-#include<set>
+#include<memory>
+#include<cstdint>
 
 namespace trimesh
 {
+	/*
+	* Name: csr_t
+	* Func: Compressed sparse row adjacency.
+	* @Varia offsets: The neighbors of row i are indices[offsets[i]] ... indices[offsets[i + 1] - 1]. The size is #rows + 1.
+	* @Varia indices: The neighbors of all the rows, row by row.
+	*/
+	struct csr_t
+	{
+		std::vector<index_t> offsets;
+		std::vector<index_t> indices;
+	};
+
+	/*
+	* Name: permutation_t
+	* Func: The new index of each old element after renumbering, e.g. vertices[old_index] = new_index.
+	*/
+	struct permutation_t
+	{
+		std::vector<index_t> vertices;
+		std::vector<index_t> faces;
+		std::vector<index_t> edges;
+		std::vector<index_t> halfedges;
+	};
+
 	/*
 	* Name: trimesh_t
 	* Func: Triangle mesh class.
@@ -15,21 +40,15 @@ namespace trimesh
 	* @Varia m_vertex_halfedges[i]: The index of one of outgoing halfedges related to vertex[i].
 	* @Varia m_face_halfedges[i]: The index of one of halfedges related to face[i].
 	* @Varia m_edge_halfedges[i]: The index of one of halfedges related to edge[i].
-	* @Varia m_edge2halfedge: The map that (vertex_i, vertex_j) -> halfedge_k.
+	* @Varia m_edge2halfedge: The flat array that (vertex_i, vertex_j) -> halfedge_k, sorted by key.
+	* @Varia m_mapping: The memory-mapped snapshot file that the arrays above read in place, if any. See "load_snapshot".
+	* @Varia m_vertex_deleted/m_face_deleted/m_edge_deleted: Deletion marks left by the topology operators, empty if nothing was deleted.
+	* @Varia m_num_threads: The number of threads used to build the mesh.
 	*/
 	class trimesh_t
 	{
-	private:
+	public:
 		typedef long index_t;
-		typedef const unsigned long number_t;
-		typedef std::map<std::pair<index_t, index_t>, index_t> edge2index_t;
-
-		struct halfedge_t;
-		std::vector<halfedge_t> m_halfedges;
-		std::vector<index_t> m_vertex_halfedges;
-		std::vector<index_t> m_face_halfedges;
-		std::vector<index_t> m_edge_halfedges;
-		edge2index_t m_edge2halfedge;
 
 		/*
 		* Name: halfedge_t
@@ -48,7 +67,128 @@ namespace trimesh
 			halfedge_t() { vertex = face = edge = next = opposite = -1; }
 		};
 
+	private:
+		typedef const unsigned long number_t;
+
+		/*
+		* Name: edge_key_t
+		* Func: Directed edge (vertex_i, vertex_j) packed into a 64-bit key, paired with an index.
+		* The key is (vertex_i << 32 | vertex_j), so sorting by key groups halfedges by origin vertex.
+		*/
+		struct edge_key_t
+		{
+			std::uint64_t key;
+			index_t index;
+		};
+		typedef std::vector<edge_key_t> edge2index_t;
+
+		array_t<halfedge_t> m_halfedges;
+		array_t<index_t> m_vertex_halfedges;
+		array_t<index_t> m_face_halfedges;
+		array_t<index_t> m_edge_halfedges;
+		array_t<edge_key_t> m_edge2halfedge;
+		std::shared_ptr<const void> m_mapping;
+		std::vector<char> m_vertex_deleted;
+		std::vector<char> m_face_deleted;
+		std::vector<char> m_edge_deleted;
+		unsigned m_num_threads = 1;
+
+		/*
+		* Name: pack_edge
+		* Func: Pack the directed edge (vertex_i, vertex_j) into a 64-bit key.
+		*/
+		static std::uint64_t pack_edge(index_t vertex_i, index_t vertex_j)
+		{
+			return (std::uint64_t(std::uint32_t(vertex_i)) << 32) | std::uint64_t(std::uint32_t(vertex_j));
+		}
+
+		/*
+		* Name: sort_edge_keys
+		* Func: Stable LSD radix sort of keys[0] ... keys[n - 1] by key, 16 bits per pass. "buffer" is scratch of at least the same size.
+		* Passes whose digit is the same for all keys are skipped.
+		*/
+		static void sort_edge_keys(edge_key_t* keys, std::size_t n, edge2index_t& buffer, unsigned num_threads);
+
+		/*
+		* Name: find_edge_key
+		* Func: Return the position of "key" in the sorted array keys[0] ... keys[n - 1], or -1 if not found.
+		*/
+		static index_t find_edge_key(const edge_key_t* keys, std::size_t n, std::uint64_t key);
+
+		/*
+		* Name: detach
+		* Func: Copy the arrays read from a snapshot into owned memory, so that the mesh can be modified.
+		*/
+		void detach();
+
+		/*
+		* Name: build_corners
+		* Func: Fill the face of each halfedge and corner2he[3 * f + c], the halfedge from corner c to corner c + 1 of face f.
+		* Both "m_edge2halfedge" and "corners" must be sorted. Requires the halfedges to be allocated.
+		*/
+		void build_corners(edge2index_t& corners, std::vector<index_t>& corner2he);
+
+		/*
+		* Name: build_links
+		* Func: Fill "m_vertex_halfedges", "m_face_halfedges" and the "next" of each halfedge from "corner2he".
+		*/
+		void build_links(number_t num_triangles, const std::vector<index_t>& corner2he);
+
+		/*
+		* Name: fill_edge_lookup
+		* Func: Fill keys[0] ... keys[num_halfedges - 1] with the edge lookup of the halfedges, sorted.
+		*/
+		void fill_edge_lookup(edge_key_t* keys) const;
+
+		/*
+		* Name: build_edge_lookup
+		* Func: Fill "m_edge2halfedge" from the halfedges and sort it.
+		*/
+		void build_edge_lookup();
+
+		/*
+		* Name: apply_permutation
+		* Func: Move every element to its new index in "permutation" and remap all the indices.
+		* Elements whose new index is -1 are dropped. Clears the deletion marks and rebuilds "m_edge2halfedge".
+		*/
+		void apply_permutation(const permutation_t& permutation, index_t num_vertices, index_t num_faces, index_t num_edges);
+
+		/*
+		* Name: begin_edit
+		* Func: Prepare the mesh for a topology operator: own the arrays and drop "m_edge2halfedge", which the operator would make stale.
+		*/
+		void begin_edit();
+
+		/*
+		* Name: new_vertex/new_face/new_edge
+		* Func: Append an element and return its index. A new edge comes with its pair of halfedges (2 * edge, 2 * edge + 1).
+		*/
+		index_t new_vertex();
+		index_t new_face();
+		index_t new_edge(index_t vertex_i, index_t vertex_j);
+
+		/*
+		* Name: adjust_outgoing_halfedge
+		* Func: Make vertex[index] store an outgoing boundary halfedge, if it has one.
+		*/
+		void adjust_outgoing_halfedge(const index_t index);
+
+		/*
+		* Name: collapse_edge/collapse_loop
+		* Func: The two steps of "collapse": remove the edge of halfedge[index], then remove a face degenerated into a loop of two halfedges.
+		*/
+		void collapse_edge(const index_t index);
+		void collapse_loop(const index_t index);
+
 	public:
+		/*
+		* Name: set_num_threads
+		* Func: Set the number of threads used by "build" and "build_from_triangles". 0 means one per hardware thread.
+		* The result doesn't depend on the number of threads.
+		*/
+		void set_num_threads(unsigned num_threads);
+		unsigned num_threads() const { return m_num_threads; }
+
 		/*
 		* Name: triangles2edges
 		* Func: Build the edges vector from the given triangles vector.
@@ -67,17 +207,282 @@ namespace trimesh
 		*/
 		void build(number_t num_vertices, number_t num_triangles, const trimesh::triangle_t* triangles, number_t num_edges, const trimesh::edge_t* edges);
 
+		/*
+		* Name: build_from_triangles
+		* Func: Build the halfedge data structures from the given triangles only, without calling "triangles2edges".
+		* The edges are numbered in (min_vi, max_vi) order, so the result is the same as "triangles2edges" followed by "build".
+		*/
+		void build_from_triangles(number_t num_vertices, number_t num_triangles, const trimesh::triangle_t* triangles);
+
+		/*
+		* Name: find_halfedge
+		* Func: Return the index of halfedge (vertex_i, vertex_j), or -1 if there's no such halfedge.
+		* After a topology operator, and until "garbage_collect", it walks the outgoing halfedges of vertex_i instead.
+		*/
+		index_t find_halfedge(index_t vertex_i, index_t vertex_j) const;
+
 		/*
 		* Name: halfedge2face
-		* Func: Return the index of face related to halfedge (vertex_i, vertex_j), according to map "e2i".
+		* Func: Return the index of face related to halfedge (vertex_i, vertex_j), or -1 if it's a boundary halfedge or doesn't exist.
+		*/
+		index_t halfedge2face(index_t vertex_i, index_t vertex_j) const;
+
+		/*
+		* Name: num_vertices/num_faces/num_edges/num_halfedges
+		* Func: Return the number of elements in the mesh.
+		*/
+		index_t num_vertices() const { return m_vertex_halfedges.size(); }
+		index_t num_faces() const { return m_face_halfedges.size(); }
+		index_t num_edges() const { return m_edge_halfedges.size(); }
+		index_t num_halfedges() const { return m_halfedges.size(); }
+
+		/*
+		* Name: halfedge/vertex_halfedge/face_halfedge/edge_halfedge
+		* Func: Read-only access to the halfedge data structures.
+		* The two halfedges of edge[i] are always allocated as the pair (2 * i, 2 * i + 1).
+		*/
+		const halfedge_t& halfedge(const index_t index) const { return m_halfedges[index]; }
+		index_t vertex_halfedge(const index_t index) const { return m_vertex_halfedges[index]; }
+		index_t face_halfedge(const index_t index) const { return m_face_halfedges[index]; }
+		index_t edge_halfedge(const index_t index) const { return m_edge_halfedges[index]; }
+
+		/*
+		* Name: circulator_kind_t
+		* Func: What a circulator walks around and what it yields.
+		* VV/VOH/VIH/VE/VF: the one-ring vertices, outgoing halfedges, incoming halfedges, edges and faces of a vertex.
+		* FV/FH/FE/FF: the vertices, halfedges, edges and neighboring faces of a face.
+		*/
+		enum circulator_kind_t { VV, VOH, VIH, VE, VF, FV, FH, FE, FF };
+
+		/*
+		* Name: circulator_t
+		* Func: Allocation-free iterator around a vertex or a face.
+		* Around a vertex, it walks the outgoing halfedges by he = m_halfedges[he.opposite].next, as "vv_neighbors" does.
+		* Around a face, it walks the halfedges by he = he.next.
+		* VF and FF skip boundary halfedges, which have no face.
+		* @Varia m_halfedges: The halfedges of the mesh.
+		* @Varia m_start: The first halfedge of the walk. -1 for an empty walk.
+		* @Varia m_current: The current halfedge.
+		* @Varia m_done: True once the walk came back to "m_start".
 		*/
-		index_t halfedge2face(const edge2index_t& e2i, index_t vertex_i, index_t vertex_j);
+		template<int kind>
+		class circulator_t
+		{
+		private:
+			const halfedge_t* m_halfedges;
+			index_t m_start;
+			index_t m_current;
+			bool m_done;
+
+			static const bool around_face = kind >= FV;
+			static const bool skip_boundary = kind == VF || kind == FF;
+
+			void step()
+			{
+				const halfedge_t& he = m_halfedges[m_current];
+				m_current = around_face ? he.next : m_halfedges[he.opposite].next;
+				m_done = m_current == m_start;
+			}
+
+			void skip()
+			{
+				while (skip_boundary && !m_done && **this == -1) { step(); }
+			}
+
+		public:
+			circulator_t(const halfedge_t* halfedges, const index_t start, const bool done)
+				: m_halfedges(halfedges), m_start(start), m_current(start), m_done(done || start == -1)
+			{
+				skip();
+			}
+
+			index_t operator*() const
+			{
+				const halfedge_t& he = m_halfedges[m_current];
+				switch (kind) {
+				case VV: case FV: return he.vertex;
+				case VOH: case FH: return m_current;
+				case VIH: return he.opposite;
+				case VE: case FE: return he.edge;
+				case VF: return he.face;
+				default: return m_halfedges[he.opposite].face;  // FF
+				}
+			}
+
+			circulator_t& operator++()
+			{
+				step();
+				skip();
+				return *this;
+			}
+
+			bool operator==(const circulator_t& other) const { return m_current == other.m_current && m_done == other.m_done; }
+			bool operator!=(const circulator_t& other) const { return !(*this == other); }
+		};
+
+		/*
+		* Name: circulator_range_t
+		* Func: The begin/end pair of a circulator, for use in range-based for loops.
+		*/
+		template<int kind>
+		class circulator_range_t
+		{
+		private:
+			const halfedge_t* m_halfedges;
+			index_t m_start;
+
+		public:
+			circulator_range_t(const halfedge_t* halfedges, const index_t start) : m_halfedges(halfedges), m_start(start) {}
+
+			circulator_t<kind> begin() const { return circulator_t<kind>(m_halfedges, m_start, false); }
+			circulator_t<kind> end() const { return circulator_t<kind>(m_halfedges, m_start, true); }
+		};
+
+		/*
+		* Name: vv_range/voh_range/vih_range/ve_range/vf_range
+		* Func: Circulate around vertex[index]: one-ring vertices, outgoing/incoming halfedges, edges and faces.
+		*/
+		circulator_range_t<VV> vv_range(const index_t index) const { return circulator_range_t<VV>(m_halfedges.data(), m_vertex_halfedges[index]); }
+		circulator_range_t<VOH> voh_range(const index_t index) const { return circulator_range_t<VOH>(m_halfedges.data(), m_vertex_halfedges[index]); }
+		circulator_range_t<VIH> vih_range(const index_t index) const { return circulator_range_t<VIH>(m_halfedges.data(), m_vertex_halfedges[index]); }
+		circulator_range_t<VE> ve_range(const index_t index) const { return circulator_range_t<VE>(m_halfedges.data(), m_vertex_halfedges[index]); }
+		circulator_range_t<VF> vf_range(const index_t index) const { return circulator_range_t<VF>(m_halfedges.data(), m_vertex_halfedges[index]); }
+
+		/*
+		* Name: fv_range/fh_range/fe_range/ff_range
+		* Func: Circulate around face[index]: vertices, halfedges, edges and neighboring faces.
+		*/
+		circulator_range_t<FV> fv_range(const index_t index) const { return circulator_range_t<FV>(m_halfedges.data(), m_face_halfedges[index]); }
+		circulator_range_t<FH> fh_range(const index_t index) const { return circulator_range_t<FH>(m_halfedges.data(), m_face_halfedges[index]); }
+		circulator_range_t<FE> fe_range(const index_t index) const { return circulator_range_t<FE>(m_halfedges.data(), m_face_halfedges[index]); }
+		circulator_range_t<FF> ff_range(const index_t index) const { return circulator_range_t<FF>(m_halfedges.data(), m_face_halfedges[index]); }
 
 		/*
 		* Name: vv_neighbors
 		* Func: Record the indices of one-ring neighbors of vertex[index] into neighbors vector.
 		*/
 		void vv_neighbors(const index_t index, std::vector<index_t>& neighbors) const;
+
+		/*
+		* Name: vertex_adjacency
+		* Func: Build the one-ring neighbors (vv) and incident faces (vf) of all vertices as CSR arrays, in parallel.
+		* Row i lists the same elements in the same order as vv_range(i) and vf_range(i).
+		*/
+		void vertex_adjacency(csr_t& vv, csr_t& vf) const;
+
+		/*
+		* Name: face_components
+		* Func: Label the faces connected through edges with the same component index, and return the number of components.
+		* Components are numbered 0, 1, ... in the order of their smallest face. Deleted faces are labeled -1.
+		* A lock-free union-find over the "opposite" links of the edges runs on all the threads of the mesh.
+		*/
+		index_t face_components(std::vector<index_t>& labels) const;
+
+		/*
+		* Name: boundary_loops
+		* Func: Collect the boundary loops as CSR rows of halfedges, following the "next" links of the boundary halfedges,
+		* and return the number of loops. Loops are sorted by their smallest halfedge, which starts the row.
+		*/
+		index_t boundary_loops(csr_t& loops) const;
+
+		/*
+		* Name: reorder
+		* Func: Renumber the elements for locality of neighborhood walks, and record old -> new indices into permutation.
+		* Vertices follow the reverse Cuthill-McKee order of the vertex graph, faces follow their smallest new vertex,
+		* and edges follow the new face order. The halfedges of edge[i] stay the pair (2 * i, 2 * i + 1).
+		* The caller must apply "permutation" to its own per-vertex and per-face arrays, e.g. positions and triangles.
+		*/
+		void reorder(permutation_t& permutation);
+
+		/*
+		* Name: loop_refine
+		* Func: Build into "refined" the 1-to-4 split of every triangle used by Loop subdivision, directly from the halfedge indices.
+		* Vertex[i] keeps its index and vertex[num_vertices() + e] is the middle of edge[e]. Face[f] becomes faces 4f ... 4f + 3.
+		* Runs on the threads of the mesh. The mesh must not have deleted elements. See mesh_subdivision.h for the positions.
+		*/
+		void loop_refine(trimesh_t& refined) const;
+
+		/*
+		* Name: sqrt3_refine
+		* Func: Build into "refined" the connectivity of sqrt(3) subdivision: a vertex inside each face, connected to its corners,
+		* and every interior edge flipped to join the vertices of its two faces. Boundary edges are not flipped.
+		* Vertex[i] keeps its index and vertex[num_vertices() + f] is the center of face[f]. Face[f] becomes faces 3f ... 3f + 2.
+		* Runs on the threads of the mesh. The mesh must not have deleted elements.
+		*/
+		void sqrt3_refine(trimesh_t& refined) const;
+
+		/*
+		* Name: prev_halfedge
+		* Func: Return the halfedge whose next is halfedge[index]. O(1) inside a triangle, O(valence) on the boundary.
+		*/
+		index_t prev_halfedge(const index_t index) const;
+
+		/*
+		* Name: is_boundary_vertex/is_boundary_edge
+		* Func: Return true if the vertex/edge touches the boundary.
+		*/
+		bool is_boundary_vertex(const index_t index) const;
+		bool is_boundary_edge(const index_t index) const;
+
+		/*
+		* Name: is_vertex_deleted/is_face_deleted/is_edge_deleted
+		* Func: Return true if a topology operator deleted the element. Deleted elements are removed by "garbage_collect".
+		*/
+		bool is_vertex_deleted(const index_t index) const { return !m_vertex_deleted.empty() && m_vertex_deleted[index]; }
+		bool is_face_deleted(const index_t index) const { return !m_face_deleted.empty() && m_face_deleted[index]; }
+		bool is_edge_deleted(const index_t index) const { return !m_edge_deleted.empty() && m_edge_deleted[index]; }
+
+		/*
+		* Name: is_flip_ok/flip_edge
+		* Func: Replace edge[index], the diagonal of its two triangles, by the other diagonal. The edge keeps its index.
+		* The edge must be interior, and the other diagonal must not exist yet.
+		*/
+		bool is_flip_ok(const index_t index) const;
+		void flip_edge(const index_t index);
+
+		/*
+		* Name: split_edge
+		* Func: Insert a new vertex in the middle of edge[index] and split the 1 or 2 triangles touching it. Return the new vertex.
+		*/
+		index_t split_edge(const index_t index);
+
+		/*
+		* Name: split_face
+		* Func: Insert a new vertex inside face[index] and split it into 3 triangles. Return the new vertex.
+		*/
+		index_t split_face(const index_t index);
+
+		/*
+		* Name: is_collapse_ok/collapse
+		* Func: Merge the origin vertex of halfedge[index] into the vertex it points to, removing the edge and its 1 or 2 triangles.
+		* The origin vertex is marked deleted. "is_collapse_ok" checks the link condition, so that the mesh stays manifold.
+		*/
+		bool is_collapse_ok(const index_t index) const;
+		void collapse(const index_t index);
+
+		/*
+		* Name: garbage_collect
+		* Func: Remove the deleted elements, keeping the order of the others, and record old -> new indices into permutation.
+		* Deleted elements are mapped to -1. Rebuilds the edge lookup used by "find_halfedge".
+		*/
+		void garbage_collect(permutation_t& permutation);
+
+		/*
+		* Name: save_snapshot
+		* Func: Write the halfedge data structures into a binary snapshot file. Return false on failure.
+		* Return false as well while deleted elements remain: remove them by "garbage_collect" first. The edge lookup dropped by a topology operator is rebuilt for the file.
+		* The file has a versioned header followed by the halfedges, the vertex/face/edge halfedge tables and the edge lookup,
+		* each aligned to 64 bytes, in native byte order.
+		*/
+		bool save_snapshot(const char* filename) const;
+
+		/*
+		* Name: load_snapshot
+		* Func: Load a snapshot written by "save_snapshot". Return false if the file is missing or doesn't match this build.
+		* The file is memory-mapped and the arrays are read in place without copies; it stays mapped until the mesh is
+		* cleared, rebuilt or destroyed. Modifying the mesh copies the arrays first.
+		*/
+		bool load_snapshot(const char* filename);
 	};
 }
 
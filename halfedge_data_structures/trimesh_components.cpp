@@ -0,0 +1,116 @@
+#include"trimesh.h"
+#include"parallel.h"
+#include<atomic>
+#include<utility>
+
+namespace trimesh
+{
+	namespace
+	{
+		/*
+		* Name: concurrent_union_find_t
+		* Func: Lock-free disjoint sets. A root is only linked below a smaller root with a compare-and-swap,
+		* so the parent of an element only decreases, there are no cycles, and the final root of a set is its smallest element.
+		*/
+		class concurrent_union_find_t
+		{
+		private:
+			std::vector<std::atomic<index_t>> m_parent;
+
+		public:
+			concurrent_union_find_t(std::size_t n, unsigned num_threads) : m_parent(n)
+			{
+				parallel_for(0, n, num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+					for (std::size_t i = begin; i < end; ++i) { m_parent[i].store(i, std::memory_order_relaxed); }
+				});
+			}
+
+			index_t find(index_t x)
+			{
+				for (;;) {
+					index_t parent = m_parent[x].load(std::memory_order_relaxed);
+					if (parent == x) { return x; }
+					const index_t grandparent = m_parent[parent].load(std::memory_order_relaxed);
+					// Path halving. Failing is harmless: another thread moved x even closer to the root.
+					if (parent != grandparent) { m_parent[x].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed); }
+					x = grandparent;
+				}
+			}
+
+			void unite(index_t a, index_t b)
+			{
+				for (;;) {
+					a = find(a);
+					b = find(b);
+					if (a == b) { return; }
+					if (a < b) { std::swap(a, b); }
+					// Link the larger root below the smaller one, unless another thread linked it first.
+					index_t expected = a;
+					if (m_parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) { return; }
+				}
+			}
+		};
+	}
+
+	trimesh_t::index_t trimesh_t::face_components(std::vector<index_t>& labels) const
+	{
+		const std::size_t num_faces = m_face_halfedges.size();
+		const std::size_t num_edges = m_edge_halfedges.size();
+		concurrent_union_find_t sets(num_faces, m_num_threads);
+
+		parallel_for(0, num_edges, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t e = begin; e < end; ++e) {
+				if (is_edge_deleted(e)) { continue; }
+				const halfedge_t& he = m_halfedges[m_edge_halfedges[e]];
+				const index_t face_i = he.face, face_j = m_halfedges[he.opposite].face;
+				if (face_i != -1 && face_j != -1) { sets.unite(face_i, face_j); }
+			}
+		});
+
+		// The root of each component is its smallest face, so numbering the roots in order is deterministic.
+		labels.resize(num_faces);
+		parallel_for(0, num_faces, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t f = begin; f < end; ++f) { labels[f] = sets.find(f); }
+		});
+
+		index_t num_components = 0;
+		for (std::size_t f = 0; f < num_faces; ++f) {
+			if (is_face_deleted(f)) { labels[f] = -1; }
+			else if (labels[f] == index_t(f)) { labels[f] = num_components++; }
+			else { labels[f] = labels[labels[f]]; }
+		}
+		return num_components;
+	}
+
+	trimesh_t::index_t trimesh_t::boundary_loops(csr_t& loops) const
+	{
+		// Find the boundary halfedges in parallel. The chunks are concatenated in order, so the result is sorted.
+		const unsigned num_threads = m_num_threads;
+		std::vector<std::vector<index_t>> found(num_threads);
+		parallel_for(0, m_halfedges.size(), num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+			for (std::size_t h = begin; h < end; ++h) {
+				if (m_halfedges[h].face == -1 && !is_edge_deleted(h >> 1)) { found[t].push_back(h); }
+			}
+		});
+
+		std::vector<index_t> boundary;
+		for (const auto& halfedges : found) { boundary.insert(boundary.end(), halfedges.begin(), halfedges.end()); }
+
+		// Walk each loop from its smallest halfedge. The boundary is small next to the mesh, so this part is serial.
+		loops.offsets.assign(1, 0);
+		loops.indices.clear();
+		loops.indices.reserve(boundary.size());
+		std::vector<char> visited(m_halfedges.size(), 0);
+		for (std::size_t i = 0; i < boundary.size(); ++i) {
+			if (visited[boundary[i]]) { continue; }
+			index_t he_index = boundary[i];
+			do {
+				visited[he_index] = 1;
+				loops.indices.push_back(he_index);
+				he_index = m_halfedges[he_index].next;
+			} while (he_index != boundary[i]);
+			loops.offsets.push_back(loops.indices.size());
+		}
+		return loops.offsets.size() - 1;
+	}
+}
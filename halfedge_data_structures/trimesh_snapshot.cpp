@@ -0,0 +1,143 @@
+#include"trimesh.h"
+#include"mapped_file.h"
+#include<cstdio>
+#include<cstring>
+#include<cstdint>
+
+namespace trimesh
+{
+	namespace
+	{
+		const char snapshot_magic[8] = { 'T', 'R', 'I', 'M', 'E', 'S', 'H', '\0' };
+		const std::uint32_t snapshot_version = 1;
+		const std::uint32_t snapshot_byte_order = 0x01020304;
+		const std::size_t snapshot_alignment = 64;
+
+		/*
+		* Name: snapshot_header_t
+		* Func: The first 64 bytes of a snapshot file.
+		* The sizes of the index and the structures are recorded so that a file written by an incompatible build is rejected.
+		*/
+		struct snapshot_header_t
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t byte_order;
+			std::uint32_t index_size;
+			std::uint32_t halfedge_size;
+			std::uint32_t edge_key_size;
+			std::uint32_t reserved;
+			std::uint64_t num_halfedges;
+			std::uint64_t num_vertices;
+			std::uint64_t num_faces;
+			std::uint64_t num_edges;
+		};
+		static_assert(sizeof(snapshot_header_t) == 64, "The snapshot header must be 64 bytes.");
+
+		std::size_t align_up(std::size_t offset)
+		{
+			return (offset + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment;
+		}
+
+		/*
+		* Name: snapshot_layout_t
+		* Func: Byte offset of each array in the file. Each array starts at a multiple of 64 bytes.
+		*/
+		struct snapshot_layout_t
+		{
+			std::size_t halfedges, vertex_halfedges, face_halfedges, edge_halfedges, edge2halfedge, file_size;
+		};
+
+		snapshot_layout_t snapshot_layout(const snapshot_header_t& header, std::size_t halfedge_size, std::size_t edge_key_size)
+		{
+			snapshot_layout_t layout;
+			layout.halfedges = align_up(sizeof(snapshot_header_t));
+			layout.vertex_halfedges = align_up(layout.halfedges + header.num_halfedges * halfedge_size);
+			layout.face_halfedges = align_up(layout.vertex_halfedges + header.num_vertices * sizeof(index_t));
+			layout.edge_halfedges = align_up(layout.face_halfedges + header.num_faces * sizeof(index_t));
+			layout.edge2halfedge = align_up(layout.edge_halfedges + header.num_edges * sizeof(index_t));
+			layout.file_size = layout.edge2halfedge + header.num_halfedges * edge_key_size;
+			return layout;
+		}
+
+		bool write_at(std::FILE* file, std::size_t offset, const void* data, std::size_t bytes)
+		{
+			static const char zeros[snapshot_alignment] = {};
+			long position = std::ftell(file);
+			if (position < 0 || std::size_t(position) > offset) { return false; }
+			if (std::fwrite(zeros, 1, offset - position, file) != offset - position) { return false; }
+			return bytes == 0 || std::fwrite(data, 1, bytes, file) == bytes;
+		}
+	}
+
+	bool trimesh_t::save_snapshot(const char* filename) const
+	{
+		// The file has no deletion marks: deleted elements would come back as live ones. Call "garbage_collect" first.
+		if (!m_vertex_deleted.empty() || !m_face_deleted.empty() || !m_edge_deleted.empty()) { return false; }
+
+		snapshot_header_t header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+		header.version = snapshot_version;
+		header.byte_order = snapshot_byte_order;
+		header.index_size = sizeof(index_t);
+		header.halfedge_size = sizeof(halfedge_t);
+		header.edge_key_size = sizeof(edge_key_t);
+		header.num_halfedges = m_halfedges.size();
+		header.num_vertices = m_vertex_halfedges.size();
+		header.num_faces = m_face_halfedges.size();
+		header.num_edges = m_edge_halfedges.size();
+		const snapshot_layout_t layout = snapshot_layout(header, sizeof(halfedge_t), sizeof(edge_key_t));
+
+		// A topology operator dropped the lookup: the file gets a rebuilt one, as "load_snapshot" expects one key per halfedge.
+		edge2index_t lookup;
+		const edge_key_t* edge2halfedge = m_edge2halfedge.data();
+		if (m_edge2halfedge.size() != m_halfedges.size()) {
+			lookup.resize(m_halfedges.size());
+			fill_edge_lookup(lookup.data());
+			edge2halfedge = lookup.data();
+		}
+
+		std::FILE* file = std::fopen(filename, "wb");
+		if (!file) { return false; }
+		const bool ok =
+			write_at(file, 0, &header, sizeof(header)) &&
+			write_at(file, layout.halfedges, m_halfedges.data(), m_halfedges.size() * sizeof(halfedge_t)) &&
+			write_at(file, layout.vertex_halfedges, m_vertex_halfedges.data(), m_vertex_halfedges.size() * sizeof(index_t)) &&
+			write_at(file, layout.face_halfedges, m_face_halfedges.data(), m_face_halfedges.size() * sizeof(index_t)) &&
+			write_at(file, layout.edge_halfedges, m_edge_halfedges.data(), m_edge_halfedges.size() * sizeof(index_t)) &&
+			write_at(file, layout.edge2halfedge, edge2halfedge, m_halfedges.size() * sizeof(edge_key_t));
+		return std::fclose(file) == 0 && ok;
+	}
+
+	bool trimesh_t::load_snapshot(const char* filename)
+	{
+		std::shared_ptr<mapped_file_t> mapping = mapped_file_t::open(filename);
+		if (!mapping || mapping->size() < sizeof(snapshot_header_t)) { return false; }
+
+		const char* base = mapping->data();
+		snapshot_header_t header;
+		std::memcpy(&header, base, sizeof(header));
+		if (std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0 ||
+			header.version != snapshot_version ||
+			header.byte_order != snapshot_byte_order ||
+			header.index_size != sizeof(index_t) ||
+			header.halfedge_size != sizeof(halfedge_t) ||
+			header.edge_key_size != sizeof(edge_key_t) ||
+			header.num_halfedges != 2 * header.num_edges) {
+			return false;
+		}
+
+		const snapshot_layout_t layout = snapshot_layout(header, sizeof(halfedge_t), sizeof(edge_key_t));
+		if (layout.file_size > mapping->size()) { return false; }
+
+		clear();
+		m_halfedges.borrow(reinterpret_cast<const halfedge_t*>(base + layout.halfedges), header.num_halfedges);
+		m_vertex_halfedges.borrow(reinterpret_cast<const index_t*>(base + layout.vertex_halfedges), header.num_vertices);
+		m_face_halfedges.borrow(reinterpret_cast<const index_t*>(base + layout.face_halfedges), header.num_faces);
+		m_edge_halfedges.borrow(reinterpret_cast<const index_t*>(base + layout.edge_halfedges), header.num_edges);
+		m_edge2halfedge.borrow(reinterpret_cast<const edge_key_t*>(base + layout.edge2halfedge), header.num_halfedges);
+		m_mapping = mapping;
+		return true;
+	}
+}
@@ -0,0 +1,198 @@
+#include"trimesh.h"
+#include"parallel.h"
+#include<cassert>
+
+namespace trimesh
+{
+	namespace
+	{
+		typedef trimesh_t::halfedge_t halfedge_t;
+
+		// Fill all the fields of a halfedge. The edge and the opposite follow from the (2e, 2e + 1) pairing.
+		void set_halfedge(halfedge_t* halfedges, index_t h, index_t vertex, index_t face, index_t next)
+		{
+			halfedge_t& he = halfedges[h];
+			he.vertex = vertex;
+			he.face = face;
+			he.edge = h >> 1;
+			he.next = next;
+			he.opposite = h ^ 1;
+		}
+
+		/*
+		* Name: first_half/second_half
+		* Func: The two halves of halfedge h (a -> b) after its edge e is split at the middle m, in the 1-to-4 split:
+		* edge e becomes the edges 2e (a, m) and 2e + 1 (m, b), where a and b are the ends of halfedge 2e.
+		* first_half(h) is a -> m and second_half(h) is m -> b.
+		*/
+		index_t first_half(index_t h) { return (h & 1) ? 2 * h + 1 : 2 * h; }
+		index_t second_half(index_t h) { return (h & 1) ? 2 * h - 1 : 2 * h + 2; }
+	}
+
+	void trimesh_t::loop_refine(trimesh_t& refined) const
+	{
+		assert(&refined != this);
+		assert(m_vertex_deleted.empty() && m_face_deleted.empty() && m_edge_deleted.empty());
+		const index_t num_vertices = m_vertex_halfedges.size(), num_faces = m_face_halfedges.size(), num_edges = m_edge_halfedges.size();
+		const index_t num_halfedges = m_halfedges.size();
+		const halfedge_t* old_halfedges = m_halfedges.data();
+
+		// Old edges first: 2 per old edge, then 3 per face, between the middles of its sides.
+		std::vector<halfedge_t> halfedges(2 * (2 * num_edges + 3 * num_faces));
+		std::vector<index_t> vertex_halfedges(num_vertices + num_edges);
+		std::vector<index_t> face_halfedges(4 * num_faces);
+		std::vector<index_t> edge_halfedges(2 * num_edges + 3 * num_faces);
+		halfedge_t* new_halfedges = halfedges.data();
+
+		// Each face writes the halves of its own halfedges and its interior halfedges, so the threads never write the same halfedge.
+		parallel_for(0, num_faces, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t f = begin; f < end; ++f) {
+				// The sides h[i] (p[i] -> p[i + 1]) with the middles m[i], and the interior halfedges inner[i] (m[i + 1] -> m[i]).
+				index_t h[3], m[3], inner[3];
+				h[0] = m_face_halfedges[f];
+				h[1] = old_halfedges[h[0]].next;
+				h[2] = old_halfedges[h[1]].next;
+				for (int i = 0; i < 3; ++i) {
+					m[i] = num_vertices + (h[i] >> 1);
+					inner[i] = 2 * (2 * num_edges + 3 * f + i);
+				}
+
+				// Face 4f + i is the corner at p[i + 1]: second_half(h[i]), first_half(h[i + 1]), inner[i].
+				for (int i = 0; i < 3; ++i) {
+					const int j = (i + 1) % 3;
+					const index_t face = 4 * f + i;
+					set_halfedge(new_halfedges, second_half(h[i]), old_halfedges[h[i]].vertex, face, first_half(h[j]));
+					set_halfedge(new_halfedges, first_half(h[j]), m[j], face, inner[i]);
+					set_halfedge(new_halfedges, inner[i], m[i], face, second_half(h[i]));
+					face_halfedges[face] = second_half(h[i]);
+				}
+
+				// Face 4f + 3 is the middle: the opposites of the interior halfedges, m[i] -> m[i + 1].
+				for (int i = 0; i < 3; ++i) {
+					const int j = (i + 1) % 3;
+					set_halfedge(new_halfedges, inner[i] + 1, m[j], 4 * f + 3, inner[j] + 1);
+				}
+				face_halfedges[4 * f + 3] = inner[0] + 1;
+			}
+		});
+
+		// The boundary halfedges, the edges and the vertices.
+		parallel_for(0, num_halfedges, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t h = begin; h < end; ++h) {
+				const halfedge_t& he = old_halfedges[h];
+				const index_t middle = num_vertices + (h >> 1);
+				if (he.face == -1) {
+					set_halfedge(new_halfedges, first_half(h), middle, -1, second_half(h));
+					set_halfedge(new_halfedges, second_half(h), he.vertex, -1, first_half(he.next));
+				}
+				if ((h & 1) == 0) {
+					edge_halfedges[h] = 2 * h;
+					edge_halfedges[h + 1] = 2 * h + 2;
+					// A boundary vertex keeps a boundary outgoing halfedge.
+					const index_t outgoing = he.face == -1 ? h : h + 1;
+					vertex_halfedges[middle] = second_half(outgoing);
+				}
+			}
+		});
+		parallel_for(0, num_vertices, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t v = begin; v < end; ++v) {
+				const index_t h = m_vertex_halfedges[v];
+				vertex_halfedges[v] = h == -1 ? -1 : first_half(h);
+			}
+		});
+		parallel_for(2 * num_edges, 2 * num_edges + 3 * num_faces, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t e = begin; e < end; ++e) { edge_halfedges[e] = 2 * e; }
+		});
+
+		refined.clear();
+		refined.m_num_threads = m_num_threads;
+		refined.m_halfedges.swap(halfedges);
+		refined.m_vertex_halfedges.swap(vertex_halfedges);
+		refined.m_face_halfedges.swap(face_halfedges);
+		refined.m_edge_halfedges.swap(edge_halfedges);
+		refined.build_edge_lookup();
+	}
+
+	void trimesh_t::sqrt3_refine(trimesh_t& refined) const
+	{
+		assert(&refined != this);
+		assert(m_vertex_deleted.empty() && m_face_deleted.empty() && m_edge_deleted.empty());
+		const index_t num_vertices = m_vertex_halfedges.size(), num_faces = m_face_halfedges.size(), num_edges = m_edge_halfedges.size();
+		const index_t num_halfedges = m_halfedges.size();
+		const halfedge_t* old_halfedges = m_halfedges.data();
+
+		// Edge e keeps its index: flipped between the centers of its faces, or as is on the boundary.
+		// Edge num_edges + 3f + i joins the origin of the i-th halfedge of face f to the center of f.
+		std::vector<halfedge_t> halfedges(2 * (num_edges + 3 * num_faces));
+		std::vector<index_t> vertex_halfedges(num_vertices + num_faces);
+		std::vector<index_t> face_halfedges(3 * num_faces);
+		std::vector<index_t> edge_halfedges(num_edges + 3 * num_faces);
+		halfedge_t* new_halfedges = halfedges.data();
+
+		// The position of halfedge h in its face, counted from the face halfedge.
+		auto corner = [&](index_t h) -> index_t {
+			const index_t f = old_halfedges[h].face;
+			const index_t h0 = m_face_halfedges[f];
+			return 3 * f + (h == h0 ? 0 : h == old_halfedges[h0].next ? 1 : 2);
+		};
+		// The halfedges from the origin of the halfedge at "corner" to the center of its face, and back.
+		auto spoke_out = [&](index_t corner) { return 2 * (num_edges + corner); };
+		auto spoke_in = [&](index_t corner) { return 2 * (num_edges + corner) + 1; };
+
+		// Halfedge h (a -> b) of face f gives face 3f + i, where h is the i-th halfedge of f.
+		// Interior edge: (a, center of the opposite face g, center of f), with halfedge h becoming center(g) -> center(f).
+		// Boundary edge: (a, b, center of f), with halfedge h unchanged.
+		// Each face writes the halfedges of its own new faces, so the threads never write the same halfedge.
+		parallel_for(0, num_faces, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t f = begin; f < end; ++f) {
+				index_t h = m_face_halfedges[f];
+				for (int i = 0; i < 3; ++i, h = old_halfedges[h].next) {
+					const halfedge_t& he = old_halfedges[h];
+					const halfedge_t& opposite = old_halfedges[he.opposite];
+					const index_t face = 3 * f + i, center = num_vertices + f;
+					const index_t a = opposite.vertex;
+					if (opposite.face != -1) {
+						const index_t out = spoke_out(corner(opposite.next));
+						set_halfedge(new_halfedges, out, num_vertices + opposite.face, face, h);
+						set_halfedge(new_halfedges, h, center, face, spoke_in(face));
+						set_halfedge(new_halfedges, spoke_in(face), a, face, out);
+					}
+					else {
+						const index_t out = spoke_out(corner(he.next));
+						set_halfedge(new_halfedges, h, he.vertex, face, out);
+						set_halfedge(new_halfedges, out, center, face, spoke_in(face));
+						set_halfedge(new_halfedges, spoke_in(face), a, face, h);
+					}
+					face_halfedges[face] = h;
+				}
+				vertex_halfedges[num_vertices + f] = spoke_in(3 * f);
+			}
+		});
+
+		// The boundary halfedges keep their boundary loops.
+		parallel_for(0, num_halfedges, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t h = begin; h < end; ++h) {
+				const halfedge_t& he = old_halfedges[h];
+				if (he.face == -1) { set_halfedge(new_halfedges, h, he.vertex, -1, he.next); }
+			}
+		});
+		parallel_for(0, num_vertices, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t v = begin; v < end; ++v) {
+				const index_t h = m_vertex_halfedges[v];
+				// A boundary vertex keeps its boundary outgoing halfedge, an interior vertex takes a spoke.
+				vertex_halfedges[v] = h == -1 || old_halfedges[h].face == -1 ? h : spoke_out(corner(h));
+			}
+		});
+		parallel_for(0, num_edges + 3 * num_faces, m_num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t e = begin; e < end; ++e) { edge_halfedges[e] = 2 * e; }
+		});
+
+		refined.clear();
+		refined.m_num_threads = m_num_threads;
+		refined.m_halfedges.swap(halfedges);
+		refined.m_vertex_halfedges.swap(vertex_halfedges);
+		refined.m_face_halfedges.swap(face_halfedges);
+		refined.m_edge_halfedges.swap(edge_halfedges);
+		refined.build_edge_lookup();
+	}
+}
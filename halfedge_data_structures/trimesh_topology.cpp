@@ -0,0 +1,399 @@
+#include"trimesh.h"
+#include<cassert>
+
+namespace trimesh
+{
+	namespace
+	{
+		/*
+		* Name: mark_deleted
+		* Func: Mark element[index] deleted. The marks are only allocated when the first element of the kind is deleted.
+		*/
+		void mark_deleted(std::vector<char>& marks, std::size_t num_elements, trimesh_t::index_t index)
+		{
+			if (marks.empty()) { marks.assign(num_elements, 0); }
+			marks[index] = 1;
+		}
+	}
+
+	void trimesh_t::begin_edit()
+	{
+		detach();
+		m_edge2halfedge.clear();
+	}
+
+	trimesh_t::index_t trimesh_t::new_vertex()
+	{
+		m_vertex_halfedges.push_back(-1);
+		if (!m_vertex_deleted.empty()) { m_vertex_deleted.push_back(0); }
+		return m_vertex_halfedges.size() - 1;
+	}
+
+	trimesh_t::index_t trimesh_t::new_face()
+	{
+		m_face_halfedges.push_back(-1);
+		if (!m_face_deleted.empty()) { m_face_deleted.push_back(0); }
+		return m_face_halfedges.size() - 1;
+	}
+
+	trimesh_t::index_t trimesh_t::new_edge(index_t vertex_i, index_t vertex_j)
+	{
+		const index_t edge = m_edge_halfedges.size();
+		const index_t he_index = 2 * edge;
+
+		halfedge_t he;
+		he.face = -1;
+		he.edge = edge;
+		he.next = -1;
+
+		// (vertex_i, vertex_j)
+		he.vertex = vertex_j;
+		he.opposite = he_index + 1;
+		m_halfedges.push_back(he);
+
+		// (vertex_j, vertex_i)
+		he.vertex = vertex_i;
+		he.opposite = he_index;
+		m_halfedges.push_back(he);
+
+		m_edge_halfedges.push_back(he_index);
+		if (!m_edge_deleted.empty()) { m_edge_deleted.push_back(0); }
+		return edge;
+	}
+
+	void trimesh_t::adjust_outgoing_halfedge(const index_t index)
+	{
+		for (const index_t he_index : voh_range(index)) {
+			if (m_halfedges[he_index].face == -1) {
+				m_vertex_halfedges[index] = he_index;
+				return;
+			}
+		}
+	}
+
+	trimesh_t::index_t trimesh_t::prev_halfedge(const index_t index) const
+	{
+		index_t he_index = index;
+		if (m_halfedges[index].face != -1) {
+			while (m_halfedges[he_index].next != index) { he_index = m_halfedges[he_index].next; }
+			return he_index;
+		}
+
+		// On the boundary, the previous halfedge is one of the halfedges coming into the origin vertex.
+		do {
+			const index_t incoming = m_halfedges[he_index].opposite;
+			if (m_halfedges[incoming].next == index) { return incoming; }
+			he_index = m_halfedges[incoming].next;
+		} while (he_index != index);
+		return -1;
+	}
+
+	bool trimesh_t::is_boundary_vertex(const index_t index) const
+	{
+		const index_t he_index = m_vertex_halfedges[index];
+		return he_index == -1 || m_halfedges[he_index].face == -1;
+	}
+
+	bool trimesh_t::is_boundary_edge(const index_t index) const
+	{
+		const index_t he_index = m_edge_halfedges[index];
+		return m_halfedges[he_index].face == -1 || m_halfedges[m_halfedges[he_index].opposite].face == -1;
+	}
+
+	bool trimesh_t::is_flip_ok(const index_t index) const
+	{
+		if (is_edge_deleted(index) || is_boundary_edge(index)) { return false; }
+
+		const index_t a0 = m_edge_halfedges[index];
+		const index_t b0 = m_halfedges[a0].opposite;
+		const index_t va1 = m_halfedges[m_halfedges[a0].next].vertex;
+		const index_t vb1 = m_halfedges[m_halfedges[b0].next].vertex;
+		return va1 != vb1 && find_halfedge(va1, vb1) == -1;
+	}
+
+	void trimesh_t::flip_edge(const index_t index)
+	{
+		assert(is_flip_ok(index));
+		begin_edit();
+
+		// Before: a0 = (vb0, va0), a1 = (va0, va1), a2 = (va1, vb0) and b0 = (va0, vb0), b1 = (vb0, vb1), b2 = (vb1, va0).
+		// After: a0 = (vb1, va1) in face fa = {a0, a2, b1}, b0 = (va1, vb1) in face fb = {b0, b2, a1}.
+		const index_t a0 = m_edge_halfedges[index];
+		const index_t b0 = m_halfedges[a0].opposite;
+		const index_t a1 = m_halfedges[a0].next;
+		const index_t a2 = m_halfedges[a1].next;
+		const index_t b1 = m_halfedges[b0].next;
+		const index_t b2 = m_halfedges[b1].next;
+		const index_t va0 = m_halfedges[a0].vertex;
+		const index_t vb0 = m_halfedges[b0].vertex;
+		const index_t fa = m_halfedges[a0].face;
+		const index_t fb = m_halfedges[b0].face;
+
+		m_halfedges[a0].vertex = m_halfedges[a1].vertex;
+		m_halfedges[b0].vertex = m_halfedges[b1].vertex;
+
+		m_halfedges[a0].next = a2;
+		m_halfedges[a2].next = b1;
+		m_halfedges[b1].next = a0;
+		m_halfedges[b0].next = b2;
+		m_halfedges[b2].next = a1;
+		m_halfedges[a1].next = b0;
+
+		m_halfedges[a1].face = fb;
+		m_halfedges[b1].face = fa;
+		m_face_halfedges[fa] = a0;
+		m_face_halfedges[fb] = b0;
+
+		// va0 and vb0 lose an interior outgoing halfedge, so their boundary halfedge (if any) is kept.
+		if (m_vertex_halfedges[va0] == b0) { m_vertex_halfedges[va0] = a1; }
+		if (m_vertex_halfedges[vb0] == a0) { m_vertex_halfedges[vb0] = b1; }
+	}
+
+	trimesh_t::index_t trimesh_t::split_edge(const index_t index)
+	{
+		assert(!is_edge_deleted(index));
+		begin_edit();
+
+		// h0 = (a, b) in face f0 = {h0, h1, h2} with h2 = (c, a), o0 = (b, a) in face f1 = {o0, o1, o2} with o1 = (a, d).
+		const index_t h0 = m_edge_halfedges[index];
+		const index_t o0 = m_halfedges[h0].opposite;
+		const index_t f0 = m_halfedges[h0].face;
+		const index_t f1 = m_halfedges[o0].face;
+		const index_t h1 = m_halfedges[h0].next;
+		const index_t o1 = m_halfedges[o0].next;
+		const index_t vb = m_halfedges[h0].vertex;
+		const index_t o0_prev = f1 == -1 ? prev_halfedge(o0) : -1;
+
+		// h0 becomes (a, m), o0 becomes (m, a), and the new edge t takes (m, b).
+		const index_t vm = new_vertex();
+		const index_t t0 = 2 * new_edge(vm, vb);
+		const index_t t1 = t0 + 1;
+		m_halfedges[h0].vertex = vm;
+
+		if (f0 != -1) {
+			// f0 = {h0, s0, h2}, f2 = {t0, h1, s1} with s0 = (m, c).
+			const index_t h2 = m_halfedges[h1].next;
+			const index_t f2 = new_face();
+			const index_t s0 = 2 * new_edge(vm, m_halfedges[h1].vertex);
+			const index_t s1 = s0 + 1;
+
+			m_halfedges[h0].next = s0;
+			m_halfedges[s0].next = h2;
+			m_halfedges[t0].next = h1;
+			m_halfedges[h1].next = s1;
+			m_halfedges[s1].next = t0;
+
+			m_halfedges[s0].face = f0;
+			m_halfedges[t0].face = f2;
+			m_halfedges[h1].face = f2;
+			m_halfedges[s1].face = f2;
+			m_face_halfedges[f0] = h0;
+			m_face_halfedges[f2] = t0;
+		}
+		else {
+			m_halfedges[h0].next = t0;
+			m_halfedges[t0].next = h1;
+		}
+
+		if (f1 != -1) {
+			// f1 = {o0, o1, r1}, f3 = {t1, r0, o2} with r0 = (m, d).
+			const index_t o2 = m_halfedges[o1].next;
+			const index_t f3 = new_face();
+			const index_t r0 = 2 * new_edge(vm, m_halfedges[o1].vertex);
+			const index_t r1 = r0 + 1;
+
+			m_halfedges[o1].next = r1;
+			m_halfedges[r1].next = o0;
+			m_halfedges[t1].next = r0;
+			m_halfedges[r0].next = o2;
+			m_halfedges[o2].next = t1;
+
+			m_halfedges[r1].face = f1;
+			m_halfedges[t1].face = f3;
+			m_halfedges[r0].face = f3;
+			m_halfedges[o2].face = f3;
+			m_face_halfedges[f1] = o0;
+			m_face_halfedges[f3] = t1;
+		}
+		else {
+			m_halfedges[o0_prev].next = t1;
+			m_halfedges[t1].next = o0;
+		}
+
+		m_vertex_halfedges[vm] = f1 == -1 ? o0 : t0;
+		if (m_vertex_halfedges[vb] == o0) { m_vertex_halfedges[vb] = t1; }
+		return vm;
+	}
+
+	trimesh_t::index_t trimesh_t::split_face(const index_t index)
+	{
+		assert(!is_face_deleted(index));
+		begin_edit();
+
+		// g0 = (a, b), g1 = (b, c), g2 = (c, a) -> faces {g0, x0, y0}, {g1, x1, y1}, {g2, x2, y2} around the new vertex m.
+		const index_t g0 = m_face_halfedges[index];
+		const index_t g1 = m_halfedges[g0].next;
+		const index_t g2 = m_halfedges[g1].next;
+
+		const index_t vm = new_vertex();
+		const index_t f1 = new_face();
+		const index_t f2 = new_face();
+		const index_t y0 = 2 * new_edge(vm, m_halfedges[g2].vertex);
+		const index_t y1 = 2 * new_edge(vm, m_halfedges[g0].vertex);
+		const index_t y2 = 2 * new_edge(vm, m_halfedges[g1].vertex);
+		const index_t x2 = y0 + 1;
+		const index_t x0 = y1 + 1;
+		const index_t x1 = y2 + 1;
+
+		const index_t faces[3] = { index, f1, f2 };
+		const index_t loops[3][3] = { { g0, x0, y0 }, { g1, x1, y1 }, { g2, x2, y2 } };
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				m_halfedges[loops[i][j]].next = loops[i][(j + 1) % 3];
+				m_halfedges[loops[i][j]].face = faces[i];
+			}
+			m_face_halfedges[faces[i]] = loops[i][0];
+		}
+
+		m_vertex_halfedges[vm] = y0;
+		return vm;
+	}
+
+	bool trimesh_t::is_collapse_ok(const index_t index) const
+	{
+		const index_t v0v1 = index;
+		const index_t v1v0 = m_halfedges[v0v1].opposite;
+		const index_t v0 = m_halfedges[v1v0].vertex;
+		const index_t v1 = m_halfedges[v0v1].vertex;
+		if (is_edge_deleted(m_halfedges[index].edge) || is_vertex_deleted(v0) || is_vertex_deleted(v1)) { return false; }
+
+		// The two other edges of a triangle touching the edge must not both be on the boundary.
+		index_t vl = -1, vr = -1;
+		const index_t sides[2] = { v0v1, v1v0 };
+		for (int i = 0; i < 2; ++i) {
+			if (m_halfedges[sides[i]].face == -1) { continue; }
+			const index_t h1 = m_halfedges[sides[i]].next;
+			const index_t h2 = m_halfedges[h1].next;
+			if (m_halfedges[m_halfedges[h1].opposite].face == -1 && m_halfedges[m_halfedges[h2].opposite].face == -1) { return false; }
+			(i == 0 ? vl : vr) = m_halfedges[h1].vertex;
+		}
+
+		// The edge must have at least one triangle, and its two triangles must not share their third vertex.
+		if (vl == vr) { return false; }
+
+		// An interior edge between two boundary vertices would pinch the mesh.
+		if (is_boundary_vertex(v0) && is_boundary_vertex(v1) && m_halfedges[v0v1].face != -1 && m_halfedges[v1v0].face != -1) { return false; }
+
+		// Link condition: the only common neighbors of v0 and v1 are vl and vr.
+		for (const index_t vi : vv_range(v0)) {
+			if (vi == vl || vi == vr) { continue; }
+			for (const index_t vj : vv_range(v1)) {
+				if (vi == vj) { return false; }
+			}
+		}
+		return true;
+	}
+
+	void trimesh_t::collapse(const index_t index)
+	{
+		assert(is_collapse_ok(index));
+		begin_edit();
+
+		const index_t h0 = index;
+		const index_t h1 = m_halfedges[h0].next;
+		const index_t o0 = m_halfedges[h0].opposite;
+		const index_t o1 = m_halfedges[o0].next;
+
+		collapse_edge(h0);
+
+		// The triangles of the edge are now loops of two halfedges.
+		if (m_halfedges[m_halfedges[h1].next].next == h1) { collapse_loop(m_halfedges[h1].next); }
+		if (m_halfedges[m_halfedges[o1].next].next == o1) { collapse_loop(o1); }
+	}
+
+	void trimesh_t::collapse_edge(const index_t index)
+	{
+		const index_t h = index;
+		const index_t hn = m_halfedges[h].next;
+		const index_t hp = prev_halfedge(h);
+		const index_t o = m_halfedges[h].opposite;
+		const index_t on = m_halfedges[o].next;
+		const index_t op = prev_halfedge(o);
+		const index_t fh = m_halfedges[h].face;
+		const index_t fo = m_halfedges[o].face;
+		const index_t vh = m_halfedges[h].vertex;
+		const index_t vo = m_halfedges[o].vertex;
+
+		for (const index_t he_index : vih_range(vo)) { m_halfedges[he_index].vertex = vh; }
+
+		m_halfedges[hp].next = hn;
+		m_halfedges[op].next = on;
+
+		if (fh != -1) { m_face_halfedges[fh] = hn; }
+		if (fo != -1) { m_face_halfedges[fo] = on; }
+
+		if (m_vertex_halfedges[vh] == o) { m_vertex_halfedges[vh] = hn; }
+		adjust_outgoing_halfedge(vh);
+		m_vertex_halfedges[vo] = -1;
+
+		mark_deleted(m_edge_deleted, m_edge_halfedges.size(), m_halfedges[h].edge);
+		mark_deleted(m_vertex_deleted, m_vertex_halfedges.size(), vo);
+	}
+
+	void trimesh_t::collapse_loop(const index_t index)
+	{
+		const index_t h0 = index;
+		const index_t h1 = m_halfedges[h0].next;
+		const index_t o0 = m_halfedges[h0].opposite;
+		const index_t o1 = m_halfedges[o0].next;
+		const index_t v0 = m_halfedges[h0].vertex;
+		const index_t v1 = m_halfedges[h1].vertex;
+		const index_t fh = m_halfedges[h0].face;
+		const index_t fo = m_halfedges[o0].face;
+		assert(m_halfedges[h1].next == h0 && h1 != o0);
+
+		// h1 replaces o0 in the face across the loop.
+		m_halfedges[h1].next = o1;
+		m_halfedges[prev_halfedge(o0)].next = h1;
+		m_halfedges[h1].face = fo;
+
+		m_vertex_halfedges[v0] = h1;
+		adjust_outgoing_halfedge(v0);
+		m_vertex_halfedges[v1] = o1;
+		adjust_outgoing_halfedge(v1);
+
+		if (fo != -1 && m_face_halfedges[fo] == o0) { m_face_halfedges[fo] = h1; }
+
+		if (fh != -1) {
+			m_face_halfedges[fh] = -1;
+			mark_deleted(m_face_deleted, m_face_halfedges.size(), fh);
+		}
+		mark_deleted(m_edge_deleted, m_edge_halfedges.size(), m_halfedges[h0].edge);
+	}
+
+	void trimesh_t::garbage_collect(permutation_t& permutation)
+	{
+		detach();
+
+		// Deleted elements map to -1, the others keep their order.
+		auto compact = [](std::vector<index_t>& perm, std::size_t num_elements, const std::vector<char>& marks) {
+			perm.resize(num_elements);
+			index_t count = 0;
+			for (std::size_t i = 0; i < num_elements; ++i) {
+				perm[i] = !marks.empty() && marks[i] ? -1 : count++;
+			}
+			return count;
+		};
+		const index_t num_vertices = compact(permutation.vertices, m_vertex_halfedges.size(), m_vertex_deleted);
+		const index_t num_faces = compact(permutation.faces, m_face_halfedges.size(), m_face_deleted);
+		const index_t num_edges = compact(permutation.edges, m_edge_halfedges.size(), m_edge_deleted);
+
+		permutation.halfedges.resize(m_halfedges.size());
+		for (std::size_t h = 0; h < m_halfedges.size(); ++h) {
+			const index_t e = permutation.edges[h >> 1];
+			permutation.halfedges[h] = e == -1 ? -1 : 2 * e + (h & 1);
+		}
+
+		apply_permutation(permutation, num_vertices, num_faces, num_edges);
+	}
+}
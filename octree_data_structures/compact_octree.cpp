@@ -0,0 +1,218 @@
+#include"compact_octree.h"
+#include"morton.h"
+#include"parallel.h"
+#include<algorithm>
+#include<cmath>
+#include<limits>
+
+namespace octree
+{
+	namespace
+	{
+		// A coordinate t in [0, 1] of a point in its leaf, to and from its stored form.
+		void encode(double t, float& c) { c = float(t); }
+		void encode(double t, std::uint16_t& c) { c = std::uint16_t(std::lround(t * 65535)); }
+		double decode(float c) { return c; }
+		double decode(std::uint16_t c) { return c * (1. / 65535); }
+
+		// The largest error on t of encode and decode.
+		double encoding_error(float) { return std::ldexp(1., -24); }
+		double encoding_error(std::uint16_t) { return 1. / 131070; }
+	}
+
+	template<typename coord_t>
+	bool compact_octree_t<coord_t>::build(const Vec3* positions, std::size_t num_points, unsigned num_threads, std::size_t leaf_size)
+	{
+		// The point indices and ranges are std::uint32_t.
+		if (num_points > std::numeric_limits<std::uint32_t>::max()) {
+			nodes.clear();
+			coords.clear();
+			indices.clear();
+			return false;
+		}
+		num_threads = resolve_num_threads(num_threads);
+		this->leaf_size = std::max<std::size_t>(1, leaf_size);
+
+		// The points in Morton order, in the bounding cube.
+		std::vector<code_key_t> keys;
+		sorted_code_keys(num_points, [positions](std::size_t i) -> const Vec3& { return positions[i]; }, max_depth, num_threads, origin, half_dim, keys);
+
+		std::vector<std::uint64_t> codes(num_points);
+		indices.resize(num_points);
+		parallel_for(0, num_points, num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				codes[i] = keys[i].code;
+				indices[i] = std::uint32_t(keys[i].index);
+			}
+		});
+		std::vector<code_key_t>().swap(keys);
+
+		// The nodes, top-down from the sorted codes.
+		nodes.clear();
+		compact_node_t root = { 0, 0, std::uint32_t(num_points) };
+		nodes.push_back(root);
+		std::vector<leaf_t> leaves;
+		const std::uint32_t cell[3] = { 0, 0, 0 };
+		build_node(0, 0, cell, 0, std::uint32_t(num_points), codes, leaves);
+		std::vector<std::uint64_t>().swap(codes);
+
+		// Then the positions, relative to the cube of their leaf.
+		coords.resize(3 * num_points);
+		min_leaf_level = max_depth;
+		for (const leaf_t& leaf : leaves) { min_leaf_level = std::min(min_leaf_level, leaf.level); }
+		parallel_for(0, leaves.size(), num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t l = begin; l < end; ++l) {
+				const leaf_t& leaf = leaves[l];
+				Vec3 leaf_pmin;
+				double size;
+				node_bounds(leaf.level, leaf.cell, leaf_pmin, size);
+				const compact_node_t& node = nodes[leaf.node];
+				for (std::uint32_t i = node.begin; i < node.end; ++i) {
+					for (int k = 0; k < 3; ++k) {
+						// Clamped: rounding in the codes may put a point a little outside of its cell.
+						const double t = (positions[indices[i]][k] - leaf_pmin[k]) / size;
+						encode(std::min(1.0, std::max(0.0, t)), coords[3 * i + k]);
+					}
+				}
+			}
+		});
+		return true;
+	}
+
+	template<typename coord_t>
+	void compact_octree_t<coord_t>::build_node(std::uint32_t node, int level, const std::uint32_t cell[3], std::uint32_t begin, std::uint32_t end,
+		const std::vector<std::uint64_t>& codes, std::vector<leaf_t>& leaves)
+	{
+		if (end - begin <= leaf_size || level == max_depth) {
+			if (begin == end) { return; }
+			leaf_t leaf = { node, level, { cell[0], cell[1], cell[2] } };
+			leaves.push_back(leaf);
+			return;
+		}
+
+		// The codes of the node share their bits above "shift" + 3. The child is the next 3 bits, like linear_octree_t::child_ranges.
+		const int shift = 3 * (max_depth - 1 - level);
+		const std::uint64_t prefix = codes[begin] & ~((std::uint64_t(8) << shift) - 1);
+		std::uint32_t bounds[9];
+		bounds[0] = begin;
+		for (int i = 1; i < 8; ++i) {
+			bounds[i] = std::uint32_t(std::lower_bound(codes.begin() + bounds[i - 1], codes.begin() + end, prefix | std::uint64_t(i) << shift) - codes.begin());
+		}
+		bounds[8] = end;
+
+		const std::uint32_t children = std::uint32_t(nodes.size());
+		nodes[node].children = children;
+		for (int i = 0; i < 8; ++i) {
+			compact_node_t child = { 0, bounds[i], bounds[i + 1] };
+			nodes.push_back(child);
+		}
+		for (int i = 0; i < 8; ++i) {
+			const std::uint32_t child_cell[3] = { 2 * cell[0] + (i >> 2 & 1), 2 * cell[1] + (i >> 1 & 1), 2 * cell[2] + (i & 1) };
+			build_node(children + i, level + 1, child_cell, bounds[i], bounds[i + 1], codes, leaves);
+		}
+	}
+
+	template<typename coord_t>
+	void compact_octree_t<coord_t>::node_bounds(int level, const std::uint32_t cell[3], Vec3& node_pmin, double& size) const
+	{
+		size = 2 * half_dim[0] / double(std::uint64_t(1) << level);
+		for (int k = 0; k < 3; ++k) {
+			node_pmin[k] = origin[k] - half_dim[k] + cell[k] * size;
+		}
+	}
+
+	template<typename coord_t>
+	std::size_t compact_octree_t<coord_t>::memory_bytes() const
+	{
+		return nodes.capacity() * sizeof(compact_node_t) + coords.capacity() * sizeof(coord_t) + indices.capacity() * sizeof(std::uint32_t);
+	}
+
+	template<typename coord_t>
+	double compact_octree_t<coord_t>::position_tolerance() const
+	{
+		if (indices.empty()) { return 0; }
+		const double size = 2 * half_dim[0] / double(std::uint64_t(1) << min_leaf_level);
+		return size * encoding_error(coord_t());
+	}
+
+	template<typename coord_t>
+	void compact_octree_t<coord_t>::append_points(std::uint32_t node, int level, const std::uint32_t cell[3], std::vector<std::size_t>& results,
+		std::vector<Vec3>* positions) const
+	{
+		const compact_node_t& n = nodes[node];
+		if (!positions) {
+			results.insert(results.end(), indices.begin() + n.begin, indices.begin() + n.end);
+			return;
+		}
+		if (n.children == 0) {
+			Vec3 leaf_pmin;
+			double size;
+			node_bounds(level, cell, leaf_pmin, size);
+			for (std::uint32_t i = n.begin; i < n.end; ++i) {
+				results.push_back(indices[i]);
+				positions->push_back(leaf_pmin + size * Vec3(decode(coords[3 * i]), decode(coords[3 * i + 1]), decode(coords[3 * i + 2])));
+			}
+			return;
+		}
+		for (int i = 0; i < 8; ++i) {
+			if (nodes[n.children + i].begin == nodes[n.children + i].end) { continue; }
+			const std::uint32_t child_cell[3] = { 2 * cell[0] + (i >> 2 & 1), 2 * cell[1] + (i >> 1 & 1), 2 * cell[2] + (i & 1) };
+			append_points(n.children + i, level + 1, child_cell, results, positions);
+		}
+	}
+
+	template<typename coord_t>
+	void compact_octree_t<coord_t>::get_points_insede_box(std::uint32_t node, int level, const std::uint32_t cell[3], const Vec3& box_pmin, const Vec3& box_pmax,
+		std::vector<std::size_t>& results, std::vector<Vec3>* positions) const
+	{
+		// The bounds of the node, padded for the rounding of the decoding so that both tests below stay conservative.
+		Vec3 node_pmin;
+		double size;
+		node_bounds(level, cell, node_pmin, size);
+		const double pad = 2 * half_dim[0] * 1e-12;
+		const Vec3 padded_pmin = node_pmin - Vec3::Constant(pad);
+		const Vec3 padded_pmax = node_pmin + Vec3::Constant(size + pad);
+
+		if (padded_pmax[0] < box_pmin[0] || padded_pmax[1] < box_pmin[1] || padded_pmax[2] < box_pmin[2]) { return; }
+		if (padded_pmin[0] > box_pmax[0] || padded_pmin[1] > box_pmax[1] || padded_pmin[2] > box_pmax[2]) { return; }
+
+		// The node is inside the box: so are all its points.
+		if (padded_pmin[0] >= box_pmin[0] && padded_pmin[1] >= box_pmin[1] && padded_pmin[2] >= box_pmin[2] &&
+			padded_pmax[0] <= box_pmax[0] && padded_pmax[1] <= box_pmax[1] && padded_pmax[2] <= box_pmax[2]) {
+			append_points(node, level, cell, results, positions);
+			return;
+		}
+
+		const compact_node_t& n = nodes[node];
+		if (n.children == 0) {
+			for (std::uint32_t i = n.begin; i < n.end; ++i) {
+				const Vec3 pos = node_pmin + size * Vec3(decode(coords[3 * i]), decode(coords[3 * i + 1]), decode(coords[3 * i + 2]));
+				if (pos[0] >= box_pmin[0] && pos[0] <= box_pmax[0] &&
+					pos[1] >= box_pmin[1] && pos[1] <= box_pmax[1] &&
+					pos[2] >= box_pmin[2] && pos[2] <= box_pmax[2]) {
+					results.push_back(indices[i]);
+					if (positions) { positions->push_back(pos); }
+				}
+			}
+			return;
+		}
+
+		for (int i = 0; i < 8; ++i) {
+			if (nodes[n.children + i].begin == nodes[n.children + i].end) { continue; }
+			const std::uint32_t child_cell[3] = { 2 * cell[0] + (i >> 2 & 1), 2 * cell[1] + (i >> 1 & 1), 2 * cell[2] + (i & 1) };
+			get_points_insede_box(n.children + i, level + 1, child_cell, box_pmin, box_pmax, results, positions);
+		}
+	}
+
+	template<typename coord_t>
+	void compact_octree_t<coord_t>::get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, std::vector<std::size_t>& results,
+		std::vector<Vec3>* positions) const
+	{
+		if (indices.empty()) { return; }
+		const std::uint32_t cell[3] = { 0, 0, 0 };
+		get_points_insede_box(0, 0, cell, box_pmin, box_pmax, results, positions);
+	}
+
+	template class compact_octree_t<float>;
+	template class compact_octree_t<std::uint16_t>;
+}
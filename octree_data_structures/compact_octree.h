@@ -0,0 +1,126 @@
+#ifndef __compact_octree_h__
+#define __compact_octree_h__
+
+#include"octree_point.h"
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+namespace octree
+{
+	/*
+	* Name: compact_node_t
+	* Func: A node of compact_octree_t, 12 bytes. Its cube is not stored: it follows from the root cube and the path to the node.
+	* @Varia children: The index of the first of the 8 children, contiguous. 0 for a leaf, since the root is nobody's child.
+	* @Varia begin/end: The points of the subtree, contiguous.
+	*/
+	struct compact_node_t
+	{
+		std::uint32_t children;
+		std::uint32_t begin;
+		std::uint32_t end;
+	};
+
+	/*
+	* Name: compact_octree_t
+	* Func: Octree for point sets too large for octree_t, which spends about 112 bytes per node and 32 per point.
+	* Nodes are compact_node_t, and the tree keeps its own copy of the positions, each one relative to the cube of its leaf
+	* and stored with a coord_t per coordinate: 16 bytes per point with float, 10 with std::uint16_t, indices included, plus 12 per node.
+	* A coordinate is stored as t = (x - leaf_min) / leaf_size in [0, 1]: as is with float, rounded to t * 65535 with std::uint16_t.
+	* The decoded positions are then within leaf_size * 2^-24 (float) or leaf_size / 131070 (std::uint16_t) of the real ones,
+	* per coordinate: position_tolerance() returns the bound of the largest leaf. Queries test the decoded positions.
+	* The points are in Morton order, and children are numbered like the octants of octree_t: x is the high bit, z the low bit.
+	* @Varia origin/half_dim: The bounding cube of the points.
+	* @Varia nodes: The nodes, the root first.
+	* @Varia coords: The 3 stored coordinates of each point, in the order of the points.
+	* @Varia indices: The index of each point in the array given to "build".
+	* @Varia leaf_size: Nodes with at most this many points are leaves.
+	* @Varia min_leaf_level: The level of the largest leaf, for position_tolerance.
+	*/
+	template<typename coord_t>
+	class compact_octree_t
+	{
+	public:
+		static const int max_depth = 21;
+
+	private:
+		Vec3 origin;
+		Vec3 half_dim;
+		std::vector<compact_node_t> nodes;
+		std::vector<coord_t> coords;
+		std::vector<std::uint32_t> indices;
+		std::size_t leaf_size;
+		int min_leaf_level;
+
+		/*
+		* Name: leaf_t
+		* Func: A non-empty leaf found by "build", with its cell, for the encoding of its points.
+		*/
+		struct leaf_t
+		{
+			std::uint32_t node;
+			int level;
+			std::uint32_t cell[3];
+		};
+
+		/*
+		* Name: build_node
+		* Func: Make nodes[node], the cell "cell" at "level", the root of the subtree of the points [begin, end) of the sorted "codes",
+		* and add its non-empty leaves to "leaves".
+		*/
+		void build_node(std::uint32_t node, int level, const std::uint32_t cell[3], std::uint32_t begin, std::uint32_t end,
+			const std::vector<std::uint64_t>& codes, std::vector<leaf_t>& leaves);
+
+		/*
+		* Name: node_bounds
+		* Func: The cube of the node at "level" in the cell "cell" of the grid of 2^level cells per axis.
+		*/
+		void node_bounds(int level, const std::uint32_t cell[3], Vec3& node_pmin, double& size) const;
+
+		/*
+		* Name: append_points
+		* Func: Append the points of the subtree to the results, without testing them: through its leaves to decode the positions.
+		*/
+		void append_points(std::uint32_t node, int level, const std::uint32_t cell[3], std::vector<std::size_t>& results, std::vector<Vec3>* positions) const;
+
+		void get_points_insede_box(std::uint32_t node, int level, const std::uint32_t cell[3], const Vec3& box_pmin, const Vec3& box_pmax,
+			std::vector<std::size_t>& results, std::vector<Vec3>* positions) const;
+
+	public:
+		compact_octree_t() : leaf_size(16), min_leaf_level(0) {}
+
+		/*
+		* Name: build
+		* Func: Build the octree of positions[0] ... positions[num_points - 1], which may be freed afterwards: the tree keeps the encoded positions.
+		* At most 2^32 - 1 points: with more, return false and leave the tree empty. Codes, sort and encoding run on "num_threads" threads,
+		* 0 for one per hardware thread.
+		*/
+		bool build(const Vec3* positions, std::size_t num_points, unsigned num_threads = 0, std::size_t leaf_size = 16);
+
+		std::size_t size() const { return indices.size(); }
+
+		/*
+		* Name: memory_bytes
+		* Func: Return the bytes used by the nodes, the coordinates and the indices.
+		*/
+		std::size_t memory_bytes() const;
+
+		/*
+		* Name: position_tolerance
+		* Func: Return the largest distance along an axis between a decoded position and the position given to "build".
+		*/
+		double position_tolerance() const;
+
+		/*
+		* Name: get_points_insede_box
+		* Func: Query the octree for points within a bounding box defined by min/max point: append the indices of the points in the array
+		* given to "build", and with "positions", their decoded positions. A node fully inside the box appends its points without testing them.
+		*/
+		void get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, std::vector<std::size_t>& results, std::vector<Vec3>* positions = nullptr) const;
+	};
+
+	typedef compact_octree_t<float> compact_octree_f_t;
+	typedef compact_octree_t<std::uint16_t> compact_octree_q_t;
+}
+
+#endif // !__compact_octree_h__
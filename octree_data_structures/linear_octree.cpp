@@ -0,0 +1,98 @@
+#include"linear_octree.h"
+#include"morton.h"
+#include"parallel.h"
+#include<algorithm>
+#include<cmath>
+
+namespace octree
+{
+	std::uint64_t linear_octree_t::morton_code(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+	{
+		return octree::morton_code(x, y, z);
+	}
+
+	void linear_octree_t::build(octree_point_t* points, std::size_t num_points, unsigned num_threads, std::size_t leaf_size)
+	{
+		num_threads = resolve_num_threads(num_threads);
+		this->leaf_size = std::max<std::size_t>(1, leaf_size);
+
+		std::vector<code_key_t> keys;
+		sorted_code_keys(num_points, [points](std::size_t i) -> const Vec3& { return points[i].getPosition(); }, max_depth, num_threads, origin, half_dim, keys);
+
+		codes.resize(num_points);
+		positions.resize(num_points);
+		this->points.resize(num_points);
+		parallel_for(0, num_points, num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				codes[i] = keys[i].code;
+				positions[i] = points[keys[i].index].getPosition();
+				this->points[i] = points + keys[i].index;
+			}
+		});
+	}
+
+	void linear_octree_t::child_ranges(int level, std::size_t begin, std::size_t end, std::size_t bounds[9]) const
+	{
+		// The codes of the node share their bits above "shift" + 3. The child is the next 3 bits.
+		const int shift = 3 * (max_depth - 1 - level);
+		const std::uint64_t prefix = codes[begin] & ~((std::uint64_t(8) << shift) - 1);
+		const std::uint64_t* first = codes.data() + begin;
+		const std::uint64_t* last = codes.data() + end;
+		bounds[0] = begin;
+		for (int i = 1; i < 8; ++i) {
+			first = std::lower_bound(first, last, prefix | std::uint64_t(i) << shift);
+			bounds[i] = first - codes.data();
+		}
+		bounds[8] = end;
+	}
+
+	void linear_octree_t::get_points_insede_box(int level, std::size_t begin, std::size_t end, const std::uint32_t cell[3],
+		const Vec3& box_pmin, const Vec3& box_pmax, std::vector<octree_point_t*>& results) const
+	{
+		// The bounds of the node, padded for the rounding of the codes so that both tests below stay conservative.
+		const double size = 2 * half_dim[0] / double(std::uint64_t(1) << level);
+		const double pad = 2 * half_dim[0] * 1e-12;
+		Vec3 node_pmin, node_pmax;
+		for (int k = 0; k < 3; ++k) {
+			node_pmin[k] = origin[k] - half_dim[k] + cell[k] * size - pad;
+			node_pmax[k] = node_pmin[k] + size + 2 * pad;
+		}
+
+		if (node_pmax[0] < box_pmin[0] || node_pmax[1] < box_pmin[1] || node_pmax[2] < box_pmin[2]) { return; }
+		if (node_pmin[0] > box_pmax[0] || node_pmin[1] > box_pmax[1] || node_pmin[2] > box_pmax[2]) { return; }
+
+		// The node is inside the box: so are all its points.
+		if (node_pmin[0] >= box_pmin[0] && node_pmin[1] >= box_pmin[1] && node_pmin[2] >= box_pmin[2] &&
+			node_pmax[0] <= box_pmax[0] && node_pmax[1] <= box_pmax[1] && node_pmax[2] <= box_pmax[2]) {
+			results.insert(results.end(), points.begin() + begin, points.begin() + end);
+			return;
+		}
+
+		if (end - begin <= leaf_size || level == max_depth) {
+			for (std::size_t i = begin; i < end; ++i) {
+				const Vec3& pos = positions[i];
+				if (pos[0] >= box_pmin[0] && pos[0] <= box_pmax[0] &&
+					pos[1] >= box_pmin[1] && pos[1] <= box_pmax[1] &&
+					pos[2] >= box_pmin[2] && pos[2] <= box_pmax[2]) {
+					results.push_back(points[i]);
+				}
+			}
+			return;
+		}
+
+		std::size_t bounds[9];
+		child_ranges(level, begin, end, bounds);
+		for (int i = 0; i < 8; ++i) {
+			if (bounds[i] == bounds[i + 1]) { continue; }
+			const std::uint32_t child_cell[3] = { 2 * cell[0] + (i >> 2 & 1), 2 * cell[1] + (i >> 1 & 1), 2 * cell[2] + (i & 1) };
+			get_points_insede_box(level + 1, bounds[i], bounds[i + 1], child_cell, box_pmin, box_pmax, results);
+		}
+	}
+
+	void linear_octree_t::get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, std::vector<octree_point_t*>& results) const
+	{
+		if (points.empty()) { return; }
+		const std::uint32_t cell[3] = { 0, 0, 0 };
+		get_points_insede_box(0, 0, points.size(), cell, box_pmin, box_pmax, results);
+	}
+}
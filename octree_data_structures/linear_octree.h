@@ -0,0 +1,71 @@
+#ifndef __linear_octree_h__
+#define __linear_octree_h__
+
+#include"octree_point.h"
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+namespace octree
+{
+	/*
+	* Name: linear_octree_t
+	* Func: Pointerless octree: the points sorted by their Morton code in the bounding cube, without nodes.
+	* A node is the range of points whose codes share a prefix of 3 bits per level, so a node and its 8 children
+	* are found by binary search in the sorted codes. Building is one radix sort instead of one allocation per split.
+	* Children are numbered like the octants of octree_t: x is the high bit, z the low bit.
+	* @Varia origin/half_dim: The bounding cube of the points.
+	* @Varia codes: The 63-bit Morton codes of the points, sorted: 21 levels of 3 bits, root first.
+	* @Varia positions/points: The positions and the points in the same order as "codes".
+	* @Varia leaf_size: Nodes with at most this many points are scanned instead of split.
+	*/
+	class linear_octree_t
+	{
+	public:
+		static const int max_depth = 21;
+
+	private:
+		Vec3 origin;
+		Vec3 half_dim;
+		std::vector<std::uint64_t> codes;
+		std::vector<Vec3> positions;
+		std::vector<octree_point_t*> points;
+		std::size_t leaf_size;
+
+		/*
+		* Name: child_ranges
+		* Func: Split the points [begin, end) of a node at "level" into its 8 children: child i is [bounds[i], bounds[i + 1]).
+		*/
+		void child_ranges(int level, std::size_t begin, std::size_t end, std::size_t bounds[9]) const;
+
+		void get_points_insede_box(int level, std::size_t begin, std::size_t end, const std::uint32_t cell[3],
+			const Vec3& box_pmin, const Vec3& box_pmax, std::vector<octree_point_t*>& results) const;
+
+	public:
+		linear_octree_t() : leaf_size(8) {}
+
+		/*
+		* Name: build
+		* Func: Build the octree of points[0] ... points[num_points - 1], which must stay alive while the octree is used.
+		* Codes, sort and gathers run on "num_threads" threads, 0 for one per hardware thread.
+		*/
+		void build(octree_point_t* points, std::size_t num_points, unsigned num_threads = 0, std::size_t leaf_size = 8);
+
+		std::size_t size() const { return points.size(); }
+
+		/*
+		* Name: get_points_insede_box
+		* Func: Query the octree for points within a bounding box defined by min/max point, like octree_t.
+		* A node fully inside the box appends its whole range without testing its points.
+		*/
+		void get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, std::vector<octree_point_t*>& results) const;
+
+		/*
+		* Name: morton_code
+		* Func: Interleave the bits of the cell coordinates (x, y, z), each of at most 21 bits, x being the highest bit of each group of 3.
+		*/
+		static std::uint64_t morton_code(std::uint32_t x, std::uint32_t y, std::uint32_t z);
+	};
+}
+
+#endif // !__linear_octree_h__
@@ -1,4 +1,6 @@
 #include"octree.h"
+#include"linear_octree.h"
+#include"compact_octree.h"
 #include"stopwatch.h"
 #include<cstdlib>
 #include<cstdio>
@@ -19,6 +21,9 @@ octree::Vec3 randVec3()
 }
 
 octree::octree_t* root;
+octree::octree_t* bulk_root;
+octree::linear_octree_t linear_root;
+octree::compact_octree_q_t compact_root;
 octree::octree_point_t* octree_points;
 std::vector<octree::Vec3> points;
 octree::Vec3 query_pmin, query_pmax;
@@ -36,15 +41,38 @@ void init()
 	// Create a cube [-2, 2]^3 centered at (0, 0, 0) organized by octree.
 	octree::Vec3 origin{ 0, 0, 0 };
 	octree::Vec3 half_dim{ 1, 1, 1 };
-	root = new octree::octree_t(origin, half_dim);
+	// Up to 16 points per leaf, and at most 21 levels.
+	root = new octree::octree_t(origin, half_dim, 16, 21);
 
 	// Insert points into the octree.
 	octree_points = new octree::octree_point_t[num_points];
 	for (int i = 0; i < num_points; ++i) {
 		octree_points[i].setPosition(points[i]);
+	}
+	double start = stopwatch();
+	for (int i = 0; i < num_points; ++i) {
 		root->insert(octree_points + i);  // base addr + offset
 	}
-	printf("Inserted points to octree\n");
+	printf("Inserted points to octree in %.5f sec.\n", stopwatch() - start);
+	fflush(stdout);
+
+	// Build the same octree from all the points at once.
+	start = stopwatch();
+	bulk_root = new octree::octree_t(octree_points, num_points, origin, half_dim, 16, 21);
+	printf("Bulk built octree in %.5f sec.\n", stopwatch() - start);
+	fflush(stdout);
+
+	// Build the linear octree of the same points.
+	start = stopwatch();
+	linear_root.build(octree_points, num_points);
+	printf("Built linear octree in %.5f sec.\n", stopwatch() - start);
+	fflush(stdout);
+
+	// Build the compact octree of the same positions, quantized to 16 bits in the leaves.
+	start = stopwatch();
+	compact_root.build(points.data(), num_points);
+	printf("Built compact octree in %.5f sec., %.1f bytes per point, tolerance %g.\n", stopwatch() - start,
+		double(compact_root.memory_bytes()) / num_points, compact_root.position_tolerance());
 	fflush(stdout);
 
 	// Create a query box.
@@ -84,6 +112,36 @@ void test_octree()
 
 	double T = stopwatch() - start;
 	printf("test_octree found %ld points in %.5f sec.\n", results.size(), T);
+
+	start = stopwatch();
+	results.clear();
+	bulk_root->get_points_insede_box(query_pmin, query_pmax, results);
+	T = stopwatch() - start;
+	printf("test_octree (bulk built) found %ld points in %.5f sec.\n", results.size(), T);
+}
+
+// Search for points within the bounding box using the linear octree.
+void test_linear_octree()
+{
+	double start = stopwatch();
+
+	std::vector<octree::octree_point_t*> results;
+	linear_root.get_points_insede_box(query_pmin, query_pmax, results);
+
+	double T = stopwatch() - start;
+	printf("test_linear_octree found %ld points in %.5f sec.\n", results.size(), T);
+}
+
+// Search for points within the bounding box using the compact octree.
+void test_compact_octree()
+{
+	double start = stopwatch();
+
+	std::vector<std::size_t> results;
+	compact_root.get_points_insede_box(query_pmin, query_pmax, results);
+
+	double T = stopwatch() - start;
+	printf("test_compact_octree found %ld points in %.5f sec.\n", results.size(), T);
 }
 
 int main(int argc, char** argv)
@@ -91,5 +149,13 @@ int main(int argc, char** argv)
 	init();
 	test_naive();
 	test_octree();
+	test_linear_octree();
+	test_compact_octree();
+
+	// All the nodes go at once with the arena of the tree.
+	double start = stopwatch();
+	delete root;
+	printf("Deleted octree in %.5f sec.\n", stopwatch() - start);
+	delete bulk_root;
 	return 0;
 }
\ No newline at end of file
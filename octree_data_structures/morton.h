@@ -0,0 +1,141 @@
+#ifndef __morton_h__
+#define __morton_h__
+
+#include"octree_point.h"
+#include"parallel.h"
+#include<algorithm>
+#include<cmath>
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+namespace octree
+{
+	/*
+	* Name: code_key_t
+	* Func: A Morton code and the index of its point, sorted together.
+	*/
+	struct code_key_t
+	{
+		std::uint64_t code;
+		std::size_t index;
+	};
+
+	// Spread the 21 low bits of x so that bit i moves to bit 3i.
+	inline std::uint64_t spread_bits(std::uint64_t x)
+	{
+		x &= 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffffULL;
+		x = (x | x << 16) & 0x1f0000ff0000ffULL;
+		x = (x | x << 8) & 0x100f00f00f00f00fULL;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+		x = (x | x << 2) & 0x1249249249249249ULL;
+		return x;
+	}
+
+	// The Morton code of the cell (x, y, z): x is the high bit of each triple of bits, z the low bit.
+	inline std::uint64_t morton_code(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+	{
+		return spread_bits(x) << 2 | spread_bits(y) << 1 | spread_bits(z);
+	}
+
+	/*
+	* Name: sort_code_keys
+	* Func: Stable LSD radix sort of keys by code, 16 bits per pass, on "num_threads" threads. Passes whose digit is the same
+	* for all keys are skipped, which is most of them for clustered points.
+	*/
+	inline void sort_code_keys(std::vector<code_key_t>& keys, unsigned num_threads)
+	{
+		const std::size_t n = keys.size();
+		if (n < 2) { return; }
+		std::vector<code_key_t> buffer(n);
+
+		// count[t][d]: the number of keys with digit d in the chunk of thread t, then the scatter position of the first of them.
+		const std::size_t radix = 1 << 16;
+		code_key_t* src = keys.data();
+		code_key_t* dst = buffer.data();
+		std::vector<std::vector<std::size_t>> count(num_threads, std::vector<std::size_t>(radix));
+		for (int shift = 0; shift < 64; shift += 16) {
+			parallel_for(0, n, num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+				std::vector<std::size_t>& c = count[t];
+				std::fill(c.begin(), c.end(), 0);
+				for (std::size_t i = begin; i < end; ++i) {
+					++c[(src[i].code >> shift) & 0xffff];
+				}
+			});
+
+			const std::size_t digit0 = (src[0].code >> shift) & 0xffff;
+			std::size_t same = 0;
+			for (unsigned t = 0; t < num_threads; ++t) { same += count[t][digit0]; }
+			if (same == n) { continue; }
+
+			std::size_t sum = 0;
+			for (std::size_t d = 0; d < radix; ++d) {
+				for (unsigned t = 0; t < num_threads; ++t) {
+					const std::size_t c = count[t][d];
+					count[t][d] = sum;
+					sum += c;
+				}
+			}
+			parallel_for(0, n, num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+				std::vector<std::size_t>& c = count[t];
+				for (std::size_t i = begin; i < end; ++i) {
+					dst[c[(src[i].code >> shift) & 0xffff]++] = src[i];
+				}
+			});
+			std::swap(src, dst);
+		}
+
+		if (src != keys.data()) { keys.swap(buffer); }
+	}
+
+	/*
+	* Name: sorted_code_keys
+	* Func: Compute the bounding cube of position(0) ... position(num_points - 1), then the keys of the points sorted by the Morton code
+	* of their cell in the grid of 2^max_depth cells per axis over the cube. On "num_threads" threads.
+	* @Varia origin/half_dim: The bounding cube, a little larger than the points so that the largest coordinates still fall into the last cell.
+	*/
+	template<typename position_t>
+	void sorted_code_keys(std::size_t num_points, const position_t& position, int max_depth, unsigned num_threads,
+		Vec3& origin, Vec3& half_dim, std::vector<code_key_t>& keys)
+	{
+		// The bounding box, reduced per thread.
+		std::vector<Vec3> thread_min(num_threads, Vec3::Constant(HUGE_VAL)), thread_max(num_threads, Vec3::Constant(-HUGE_VAL));
+		parallel_for(0, num_points, num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				thread_min[t] = thread_min[t].cwiseMin(position(i));
+				thread_max[t] = thread_max[t].cwiseMax(position(i));
+			}
+		});
+		Vec3 pmin = thread_min[0], pmax = thread_max[0];
+		for (unsigned t = 1; t < num_threads; ++t) {
+			pmin = pmin.cwiseMin(thread_min[t]);
+			pmax = pmax.cwiseMax(thread_max[t]);
+		}
+		if (num_points == 0) { pmin = pmax = Vec3::Zero(); }
+
+		origin = (pmin + pmax) * .5;
+		double half = (pmax - pmin).maxCoeff() * .5 * (1 + 1e-9);
+		if (!(half > 0)) { half = 1; }
+		half_dim = Vec3::Constant(half);
+
+		const double cells = double(1 << max_depth);
+		const double scale = cells / (2 * half);
+		const Vec3 corner = origin - half_dim;
+		keys.resize(num_points);
+		parallel_for(0, num_points, num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				std::uint32_t cell[3];
+				for (int k = 0; k < 3; ++k) {
+					const double q = std::floor((position(i)[k] - corner[k]) * scale);
+					cell[k] = std::uint32_t(std::min(cells - 1, std::max(0.0, q)));
+				}
+				keys[i].code = morton_code(cell[0], cell[1], cell[2]);
+				keys[i].index = i;
+			}
+		});
+		sort_code_keys(keys, num_threads);
+	}
+}
+
+#endif // !__morton_h__
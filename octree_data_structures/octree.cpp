@@ -1,10 +1,14 @@
 #include"octree.h"
+#include"parallel.h"
+#include<algorithm>
+#include<atomic>
+#include<cmath>
 
 namespace octree
 {
 	bool octree_t::is_leaf() const
 	{
-		return children[0] == nullptr;
+		return children == nullptr;
 	}
 
 	int octree_t::get_octant_containing_point(const Vec3& point) const
@@ -24,64 +28,417 @@ namespace octree
 		return oct;
 	}
 
+	void octree_t::push_data(octree_point_t* point)
+	{
+		if (count == capacity) {
+			// A bucket holds leaf_capacity points, unless the leaf is at max_depth: then it doubles.
+			// Bulk-built buckets are exactly full. An outgrown bucket stays in the arena until the tree is freed.
+			const std::size_t new_capacity = std::max(leaf_capacity, 2 * capacity);
+			octree_point_t** new_data = allocate<octree_point_t*>(new_capacity);
+			for (std::size_t i = 0; i < count; ++i) {
+				new_data[i] = data[i];
+			}
+			if (!arena) { ::operator delete(data); }
+			data = new_data;
+			capacity = new_capacity;
+		}
+		data[count++] = point;
+	}
+
+	void octree_t::create_children(octree_arena_t* from)
+	{
+		// Create new empty trees for each child octant, as one block of 8 siblings.
+		children = allocate<octree_t>(8, from);
+		for (int i = 0; i < 8; ++i) {
+			Vec3 new_origin = origin;
+			new_origin[0] += half_dim[0] * (i & 4 ? .5f : -.5f);  // child 4 5 6 7 will +
+			new_origin[1] += half_dim[1] * (i & 2 ? .5f : -.5f);  // child 2 3 6 7 will +
+			new_origin[2] += half_dim[2] * (i & 1 ? .5f : -.5f);  // child 1 3 5 7 will +
+			octree_t* child = new (children + i) octree_t(new_origin, half_dim * .5f, leaf_capacity, max_depth, ALLOCATE_NEW);
+			child->arena = arena;
+			child->depth = depth + 1;
+		}
+	}
+
+	void octree_t::split()
+	{
+		create_children(arena);
+
+		// Re-insert the data points that were here.
+		for (std::size_t i = 0; i < count; ++i) {
+			children[get_octant_containing_point(data[i]->getPosition())].insert(data[i]);
+		}
+		if (!arena) { ::operator delete(data); }
+		data = nullptr;
+		count = capacity = 0;
+	}
+
 	void octree_t::insert(octree_point_t* point)
 	{
 		if (is_leaf()) {
-			if (data == nullptr) {  // End condition.
-				data = point;
+			if (count < leaf_capacity || depth >= max_depth) {  // End condition.
+				push_data(point);
 				return;
 			}
 			else {
-				// Save this data point that was here for a later re-insert.
-				octree_point_t* old_point = data;
-				data = nullptr;
+				// Split the current node, and insert this new point.
+				split();
+				children[get_octant_containing_point(point->getPosition())].insert(point);
+			}
+		}
+		else {
+			int octant = get_octant_containing_point(point->getPosition());
+			children[octant].insert(point);
+		}
+	}
 
-				// Split the current node and create new empty trees for each child octant.
-				for (int i = 0; i < 8; ++i) {
-					Vec3 new_origin = origin;
-					new_origin[0] += half_dim[0] * (i & 4 ? .5f : -.5f);  // child 4 5 6 7 will +
-					new_origin[1] += half_dim[1] * (i & 2 ? .5f : -.5f);  // child 2 3 6 7 will +
-					new_origin[2] += half_dim[2] * (i & 1 ? .5f : -.5f);  // child 1 3 5 7 will +
-					children[i] = new octree_t(new_origin, half_dim * .5f);
+	void octree_t::partition(build_entry_t* entries, std::size_t n, std::size_t bounds[9]) const
+	{
+		std::size_t counts[8] = { 0 };
+		for (std::size_t i = 0; i < n; ++i) {
+			++counts[get_octant_containing_point(entries[i].position)];
+		}
+		std::size_t next[8];
+		bounds[0] = 0;
+		for (int i = 0; i < 8; ++i) {
+			next[i] = bounds[i];
+			bounds[i + 1] = bounds[i] + counts[i];
+		}
+
+		// Each entry moves to the next free place of its octant, and the entry it displaces moves on in turn.
+		for (int i = 0; i < 8; ++i) {
+			while (next[i] < bounds[i + 1]) {
+				build_entry_t entry = entries[next[i]];
+				int octant = get_octant_containing_point(entry.position);
+				while (octant != i) {
+					std::swap(entry, entries[next[octant]++]);
+					octant = get_octant_containing_point(entry.position);
 				}
+				entries[next[i]++] = entry;
+			}
+		}
+	}
 
-				// Re-insert the old point, and insert this new point.
-				children[get_octant_containing_point(old_point->getPosition())]->insert(old_point);
-				children[get_octant_containing_point(point->getPosition())]->insert(point);
+	void octree_t::build_subtree(build_entry_t* entries, std::size_t n, octree_point_t** buckets, octree_arena_t* from)
+	{
+		if (n <= leaf_capacity || depth >= max_depth) {
+			if (n == 0) { return; }
+			data = arena ? buckets : allocate<octree_point_t*>(n, nullptr);
+			for (std::size_t i = 0; i < n; ++i) {
+				data[i] = entries[i].point;
 			}
+			count = capacity = n;
+			return;
 		}
-		else {
-			int octant = get_octant_containing_point(point->getPosition());
-			children[octant]->insert(point);
+
+		create_children(from);
+		std::size_t bounds[9];
+		partition(entries, n, bounds);
+		for (int i = 0; i < 8; ++i) {
+			children[i].build_subtree(entries + bounds[i], bounds[i + 1] - bounds[i], buckets ? buckets + bounds[i] : nullptr, from);
 		}
 	}
 
-	void octree_t::get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, std::vector<octree_point_t*>& results)
+	void octree_t::build(octree_point_t* points, std::size_t num_points, unsigned num_threads)
 	{
-		// Leaf node: see if the current data point is inside the bounding box.
+		num_threads = resolve_num_threads(num_threads);
+		if (num_points == 0) { return; }
+
+		// With the arena, the buckets of all the leaves are one array as long lived as the tree.
+		octree_point_t** buckets = arena ? allocate<octree_point_t*>(num_points) : nullptr;
+		std::vector<build_entry_t> entries(num_points);
+		parallel_for(0, num_points, num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				entries[i].position = points[i].getPosition();
+				entries[i].point = points + i;
+			}
+		});
+
+		if (num_threads == 1) {
+			build_subtree(entries.data(), num_points, buckets, arena);
+			return;
+		}
+
+		/*
+		* Name: task_t
+		* Func: An empty leaf and the range of "entries" of its subtree.
+		*/
+		struct task_t
+		{
+			octree_t* node;
+			std::size_t begin, end;
+		};
+
+		// Split the nodes larger than "grain" with all the threads, until there are enough subtrees to share.
+		// Each thread counts the octants of its chunk, then scatters it to "buffer", which is copied back.
+		const std::size_t grain = std::max<std::size_t>(num_points / (8 * num_threads), 1);
+		std::vector<task_t> tasks, large;
+		std::vector<build_entry_t> buffer;
+		std::vector<std::size_t> counts(8 * num_threads);
+		task_t root = { this, 0, num_points };
+		large.push_back(root);
+		while (!large.empty()) {
+			const task_t task = large.back();
+			large.pop_back();
+			octree_t* node = task.node;
+			const std::size_t n = task.end - task.begin;
+			if (n <= grain || n <= leaf_capacity || node->depth >= max_depth) {
+				tasks.push_back(task);
+				continue;
+			}
+
+			build_entry_t* range = entries.data() + task.begin;
+			parallel_for(0, n, num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+				std::size_t* c = counts.data() + 8 * t;
+				std::fill(c, c + 8, 0);
+				for (std::size_t i = begin; i < end; ++i) {
+					++c[node->get_octant_containing_point(range[i].position)];
+				}
+			});
+			std::size_t bounds[9];
+			std::size_t sum = 0;
+			for (int i = 0; i < 8; ++i) {
+				bounds[i] = sum;
+				for (unsigned t = 0; t < num_threads; ++t) {
+					const std::size_t c = counts[8 * t + i];
+					counts[8 * t + i] = sum;
+					sum += c;
+				}
+			}
+			bounds[8] = sum;
+			buffer.resize(n);
+			parallel_for(0, n, num_threads, [&](unsigned t, std::size_t begin, std::size_t end) {
+				std::size_t* c = counts.data() + 8 * t;
+				for (std::size_t i = begin; i < end; ++i) {
+					buffer[c[node->get_octant_containing_point(range[i].position)]++] = range[i];
+				}
+			});
+			parallel_for(0, n, num_threads, [&](unsigned, std::size_t begin, std::size_t end) {
+				std::copy(buffer.begin() + begin, buffer.begin() + end, range + begin);
+			});
+
+			node->create_children(arena);
+			for (int i = 0; i < 8; ++i) {
+				task_t child = { node->children + i, task.begin + bounds[i], task.begin + bounds[i + 1] };
+				large.push_back(child);
+			}
+		}
+		std::vector<build_entry_t>().swap(buffer);
+
+		// Then each thread takes the subtrees one by one, largest first, and allocates from an arena of its own.
+		// The arena of the tree takes their memory once they are done.
+		std::sort(tasks.begin(), tasks.end(), [](const task_t& a, const task_t& b) { return a.end - a.begin > b.end - b.begin; });
+		const unsigned used_threads = unsigned(std::min<std::size_t>(num_threads, tasks.size()));
+		std::vector<octree_arena_t> thread_arenas(arena ? used_threads : 0);
+		std::atomic<std::size_t> next(0);
+		run_on_threads(used_threads, [&](unsigned t) {
+			octree_arena_t* from = arena ? &thread_arenas[t] : nullptr;
+			for (;;) {
+				const std::size_t i = next.fetch_add(1);
+				if (i >= tasks.size()) { break; }
+				const task_t& task = tasks[i];
+				task.node->build_subtree(entries.data() + task.begin, task.end - task.begin, buckets ? buckets + task.begin : nullptr, from);
+			}
+		});
+		for (octree_arena_t& thread_arena : thread_arenas) {
+			arena->adopt(thread_arena);
+		}
+	}
+
+	std::size_t octree_t::size() const
+	{
+		if (is_leaf()) { return count; }
+		std::size_t n = 0;
+		for (int i = 0; i < 8; ++i) {
+			n += children[i].size();
+		}
+		return n;
+	}
+
+	void octree_t::get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, std::vector<octree_point_t*>& results) const
+	{
+		get_points_insede_box(box_pmin, box_pmax, Vec3::Constant(-HUGE_VAL), Vec3::Constant(HUGE_VAL), results);
+	}
+
+	void octree_t::get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, const Vec3& node_pmin, const Vec3& node_pmax,
+		std::vector<octree_point_t*>& results) const
+	{
+		// Leaf node: see which data points of the bucket are inside the bounding box.
 		if (is_leaf()) {
-			if (data != nullptr) {
-				const Vec3& pos = data->getPosition();
+			for (std::size_t i = 0; i < count; ++i) {
+				octree_point_t* point = data[i];
+				const Vec3& pos = point->getPosition();
 				if (pos[0] >= box_pmin[0] && pos[0] <= box_pmax[0] && 
 					pos[1] >= box_pmin[1] && pos[1] <= box_pmax[1] && 
 					pos[2] >= box_pmin[2] && pos[2] <= box_pmax[2]) {
-					results.push_back(data);
+					results.push_back(point);
 				}
 			}
+			return;
 		}
 
-		// Interior node: see if the child octant intersects with the bounding box.
-		// Note: It's incorrect that the child octant must be inside the bounding box.
-		else {
-			for (int i = 0; i < 8; ++i) {
-				// Compute the min/max corners of the child octant.
-				const Vec3 child_pmax = children[i]->origin + children[i]->half_dim;
-				const Vec3 child_pmin = children[i]->origin - children[i]->half_dim;
+		// Interior node: the octants intersecting the box, and those inside it, for all 8 at once.
+		// Along each axis, the lower octants are [node_pmin, origin] and the upper ones [origin, node_pmax]:
+		// bit i of "lower[k]" is set when octant i is a lower one along axis k.
+		static const unsigned lower[3] = { 0x0f, 0x33, 0x55 };
+		unsigned overlap = 0xff, inside = 0xff;
+		for (int k = 0; k < 3; ++k) {
+			const unsigned upper = ~lower[k] & 0xff;
+			overlap &= (box_pmin[k] <= origin[k] && box_pmax[k] >= node_pmin[k] ? lower[k] : 0) |
+				(box_pmax[k] >= origin[k] && box_pmin[k] <= node_pmax[k] ? upper : 0);
+			inside &= (box_pmin[k] <= node_pmin[k] && box_pmax[k] >= origin[k] ? lower[k] : 0) |
+				(box_pmin[k] <= origin[k] && box_pmax[k] >= node_pmax[k] ? upper : 0);
+		}
 
-				if (child_pmax[0] < box_pmin[0] || child_pmax[1] < box_pmin[1] || child_pmax[2] < box_pmin[2]) { continue; }
-				if (child_pmin[0] > box_pmax[0] || child_pmin[1] > box_pmax[1] || child_pmin[2] > box_pmax[2]) { continue; }
-				children[i]->get_points_insede_box(box_pmin, box_pmax, results);
+		for (int i = 0; i < 8; ++i) {
+			if (!(overlap >> i & 1)) { continue; }
+			if (inside >> i & 1) {
+				children[i].get_all_points(results);
+				continue;
+			}
+			Vec3 child_pmin, child_pmax;
+			child_bounds(i, node_pmin, node_pmax, child_pmin, child_pmax);
+			children[i].get_points_insede_box(box_pmin, box_pmax, child_pmin, child_pmax, results);
+		}
+	}
+
+	void octree_t::get_all_points(std::vector<octree_point_t*>& results) const
+	{
+		if (is_leaf()) {
+			results.insert(results.end(), data, data + count);
+			return;
+		}
+		for (int i = 0; i < 8; ++i) {
+			children[i].get_all_points(results);
+		}
+	}
+
+	void octree_t::child_bounds(int i, const Vec3& node_pmin, const Vec3& node_pmax, Vec3& child_pmin, Vec3& child_pmax) const
+	{
+		for (int k = 0; k < 3; ++k) {
+			const bool upper = i >> (2 - k) & 1;
+			child_pmin[k] = upper ? origin[k] : node_pmin[k];
+			child_pmax[k] = upper ? node_pmax[k] : origin[k];
+		}
+	}
+
+	double octree_t::squared_distance(const Vec3& point, const Vec3& pmin, const Vec3& pmax)
+	{
+		double d2 = 0;
+		for (int k = 0; k < 3; ++k) {
+			const double d = std::max(0.0, std::max(pmin[k] - point[k], point[k] - pmax[k]));
+			d2 += d * d;
+		}
+		return d2;
+	}
+
+	void octree_t::get_k_nearest(const Vec3& point, std::size_t k, std::vector<octree_point_t*>& results, std::vector<double>& squared_distances,
+		octree_query_scratch_t& scratch) const
+	{
+		typedef octree_query_scratch_t::node_t node_entry_t;
+		typedef std::pair<double, octree_point_t*> point_entry_t;
+		auto farther = [](const node_entry_t& a, const node_entry_t& b) { return a.squared_distance > b.squared_distance; };
+		auto nearer = [](const point_entry_t& a, const point_entry_t& b) { return a.first < b.first; };
+
+		std::vector<node_entry_t>& nodes = scratch.nodes;
+		std::vector<point_entry_t>& candidates = scratch.candidates;
+		nodes.clear();
+		candidates.clear();
+		results.clear();
+		squared_distances.clear();
+		if (k == 0) { return; }
+
+		// The root's bounds are infinite, like in the box query: its outer octants hold the points outside its cube.
+		node_entry_t root = { 0.0, this, Vec3::Constant(-HUGE_VAL), Vec3::Constant(HUGE_VAL) };
+		nodes.push_back(root);
+		while (!nodes.empty()) {
+			// The nearest node can't hold anything nearer than the k-th candidate: neither can the others.
+			std::pop_heap(nodes.begin(), nodes.end(), farther);
+			const node_entry_t node = nodes.back();
+			nodes.pop_back();
+			if (candidates.size() == k && node.squared_distance >= candidates.front().first) { break; }
+
+			if (node.node->is_leaf()) {
+				for (std::size_t i = 0; i < node.node->count; ++i) {
+					octree_point_t* p = node.node->data[i];
+					const double d2 = (p->getPosition() - point).squaredNorm();
+					if (candidates.size() < k) {
+						candidates.push_back(point_entry_t(d2, p));
+						std::push_heap(candidates.begin(), candidates.end(), nearer);
+					}
+					else if (d2 < candidates.front().first) {
+						std::pop_heap(candidates.begin(), candidates.end(), nearer);
+						candidates.back() = point_entry_t(d2, p);
+						std::push_heap(candidates.begin(), candidates.end(), nearer);
+					}
+				}
+			}
+			else {
+				// The squared distances along each axis to the lower and the upper octants, summed for each child.
+				const Vec3& origin = node.node->origin;
+				double lower[3], upper[3];
+				for (int a = 0; a < 3; ++a) {
+					const double dl = std::max(0.0, std::max(node.pmin[a] - point[a], point[a] - origin[a]));
+					const double du = std::max(0.0, std::max(origin[a] - point[a], point[a] - node.pmax[a]));
+					lower[a] = dl * dl;
+					upper[a] = du * du;
+				}
+				for (int i = 0; i < 8; ++i) {
+					const double d2 = (i & 4 ? upper[0] : lower[0]) + (i & 2 ? upper[1] : lower[1]) + (i & 1 ? upper[2] : lower[2]);
+					if (candidates.size() == k && d2 >= candidates.front().first) { continue; }
+					node_entry_t child;
+					child.squared_distance = d2;
+					child.node = node.node->children + i;
+					node.node->child_bounds(i, node.pmin, node.pmax, child.pmin, child.pmax);
+					nodes.push_back(child);
+					std::push_heap(nodes.begin(), nodes.end(), farther);
+				}
+			}
+		}
+
+		std::sort_heap(candidates.begin(), candidates.end(), nearer);
+		for (const point_entry_t& candidate : candidates) {
+			results.push_back(candidate.second);
+			squared_distances.push_back(candidate.first);
+		}
+	}
+
+	void octree_t::get_points_inside_radius(const Vec3& point, double radius, std::vector<octree_point_t*>& results, std::vector<double>& squared_distances,
+		octree_query_scratch_t& scratch) const
+	{
+		// Depth-first, with the node heap of the scratch used as a plain stack.
+		typedef octree_query_scratch_t::node_t node_entry_t;
+		std::vector<node_entry_t>& stack = scratch.nodes;
+		stack.clear();
+		results.clear();
+		squared_distances.clear();
+		const double radius2 = radius * radius;
+
+		node_entry_t root = { 0.0, this, Vec3::Constant(-HUGE_VAL), Vec3::Constant(HUGE_VAL) };
+		stack.push_back(root);
+		while (!stack.empty()) {
+			const node_entry_t node = stack.back();
+			stack.pop_back();
+			if (squared_distance(point, node.pmin, node.pmax) > radius2) { continue; }
+
+			if (node.node->is_leaf()) {
+				for (std::size_t i = 0; i < node.node->count; ++i) {
+					const double d2 = (node.node->data[i]->getPosition() - point).squaredNorm();
+					if (d2 <= radius2) {
+						results.push_back(node.node->data[i]);
+						squared_distances.push_back(d2);
+					}
+				}
+			}
+			else {
+				for (int i = 0; i < 8; ++i) {
+					node_entry_t child;
+					child.squared_distance = 0;
+					child.node = node.node->children + i;
+					node.node->child_bounds(i, node.pmin, node.pmax, child.pmin, child.pmax);
+					stack.push_back(child);
+				}
 			}
 		}
 	}
-}
\ No newline at end of file
+}
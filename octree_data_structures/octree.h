@@ -2,45 +2,212 @@
 #define __octree_h__
 
 #include"octree_point.h"
+#include"octree_arena.h"
 #include<cstddef>
 #include<vector>
+#include<utility>
 
 namespace octree
 {
+	/*
+	* Name: allocation_t
+	* Func: Where an octree_t puts its nodes and leaf buckets.
+	* ALLOCATE_POOL takes them from an octree_arena_t owned by the root, freed all at once with the tree.
+	* ALLOCATE_NEW allocates each block with operator new and frees the tree recursively.
+	*/
+	enum allocation_t { ALLOCATE_POOL, ALLOCATE_NEW };
+
+	class octree_t;
+
+	/*
+	* Name: octree_query_scratch_t
+	* Func: Working memory of the nearest neighbor and radius queries. Keep one per thread and pass it to every query:
+	* once its arrays have grown, a query allocates nothing.
+	* @Varia nodes: The nodes to visit with their bounds, as a min-heap by squared distance to the query point.
+	* @Varia candidates: The k nearest points found so far, as a max-heap by squared distance.
+	*/
+	struct octree_query_scratch_t
+	{
+		/*
+		* Name: node_t
+		* Func: A node to visit and the bounds of its points, derived from its parent's like in the box query.
+		*/
+		struct node_t
+		{
+			double squared_distance;
+			const octree_t* node;
+			Vec3 pmin;
+			Vec3 pmax;
+		};
+
+		std::vector<node_t> nodes;
+		std::vector<std::pair<double, octree_point_t*>> candidates;
+	};
+
 	/*
 	* Name: octree_t
 	* Func: octree/octree node class.
 	* @Varia origin: The pyhsical center of the node.
 	* @Varia half_dim: Half the width/height/depth of the node (cube).
-	* @Varia children: Pointers to child octants.
-	* @Varia data: Data to be stored at the node.
+	* @Varia children: The 8 child octants, contiguous. nullptr for a leaf.
+	* @Varia data/count/capacity: Data to be stored at the node: the bucket of points of a leaf, contiguous.
+	* @Varia arena: The arena of the tree with ALLOCATE_POOL, nullptr with ALLOCATE_NEW.
+	* @Varia depth: The depth of the node, 0 for the root.
+	* @Varia leaf_capacity: A leaf splits when a point is inserted into it while it holds this many points.
+	* @Varia max_depth: Leaves at this depth never split, so that duplicate points can't recurse without bound.
 	*/
 	class octree_t
 	{
 	private:
 		Vec3 origin;
 		Vec3 half_dim;
-		octree_t* children[8];
-		octree_point_t* data;
+		octree_t* children;
+		octree_point_t** data;
+		std::size_t count;
+		std::size_t capacity;
+		octree_arena_t* arena;
+		int depth;
+		std::size_t leaf_capacity;
+		int max_depth;
+
+		/*
+		* Name: allocate
+		* Func: Allocate an array of n objects of type T from the arena, or with operator new.
+		*/
+		template<typename T>
+		T* allocate(std::size_t n)
+		{
+			return allocate<T>(n, arena);
+		}
+
+		// From "from" instead of the arena of the tree: the threads of a bulk build each have their own.
+		template<typename T>
+		static T* allocate(std::size_t n, octree_arena_t* from)
+		{
+			if (from) { return static_cast<T*>(from->allocate(n * sizeof(T), alignof(T))); }
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+
+		/*
+		* Name: push_data
+		* Func: Append a point to the bucket, growing it if it's full.
+		*/
+		void push_data(octree_point_t* point);
+
+		/*
+		* Name: create_children
+		* Func: Create the 8 empty children of a leaf, allocated from "from".
+		*/
+		void create_children(octree_arena_t* from);
+
+		/*
+		* Name: split
+		* Func: Create the 8 children of a leaf and move its points into them.
+		*/
+		void split();
+
+		/*
+		* Name: build_entry_t
+		* Func: A point and a copy of its position, partitioned by a bulk build: contiguous, unlike the points behind the pointers.
+		*/
+		struct build_entry_t
+		{
+			Vec3 position;
+			octree_point_t* point;
+		};
+
+		/*
+		* Name: partition
+		* Func: Reorder entries[0] ... entries[n - 1] in place by octant: octant i gets [bounds[i], bounds[i + 1]).
+		*/
+		void partition(build_entry_t* entries, std::size_t n, std::size_t bounds[9]) const;
+
+		/*
+		* Name: build_subtree
+		* Func: Make the empty leaf the root of the subtree of entries[0] ... entries[n - 1], splitting it like "insert" would.
+		* The nodes are allocated from "from". With the arena, the leaves take their buckets from "buckets", in the same order as the entries.
+		*/
+		void build_subtree(build_entry_t* entries, std::size_t n, octree_point_t** buckets, octree_arena_t* from);
+
+		/*
+		* Name: build
+		* Func: Bulk build of an empty root: split the large nodes on all the threads, then share the remaining subtrees between the threads.
+		*/
+		void build(octree_point_t* points, std::size_t num_points, unsigned num_threads);
+
+		/*
+		* Name: get_points_insede_box
+		* Func: The box query on the subtree whose points lie in [node_pmin, node_pmax]. The bounds are derived from the parent's
+		* on the way down: the root's are infinite, since insert puts the points outside its cube into its outer octants.
+		*/
+		void get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, const Vec3& node_pmin, const Vec3& node_pmax,
+			std::vector<octree_point_t*>& results) const;
+
+		/*
+		* Name: get_all_points
+		* Func: Append all the points of the subtree to "results".
+		*/
+		void get_all_points(std::vector<octree_point_t*>& results) const;
+
+		/*
+		* Name: child_bounds
+		* Func: The bounds of the points of child i, from the bounds [node_pmin, node_pmax] of the points of the node:
+		* along each axis, [node_pmin, origin] for a lower octant and [origin, node_pmax] for an upper one.
+		*/
+		void child_bounds(int i, const Vec3& node_pmin, const Vec3& node_pmax, Vec3& child_pmin, Vec3& child_pmax) const;
+
+		/*
+		* Name: squared_distance
+		* Func: Return the squared distance from the point to the box [pmin, pmax], 0 inside. The box may be infinite.
+		*/
+		static double squared_distance(const Vec3& point, const Vec3& pmin, const Vec3& pmax);
 
 	public:
-		octree_t(const Vec3& origin, const Vec3& half_dim)
+		octree_t(const Vec3& origin, const Vec3& half_dim, std::size_t leaf_capacity = 1, int max_depth = 21, allocation_t allocation = ALLOCATE_POOL)
 		{
 			this->origin = origin;
 			this->half_dim = half_dim;
-			for (int i = 0; i < 8; ++i) {
-				children[i] = nullptr;
-			}
+			children = nullptr;
 			data = nullptr;
+			count = capacity = 0;
+			arena = allocation == ALLOCATE_POOL ? new octree_arena_t() : nullptr;
+			this->depth = 0;
+			this->leaf_capacity = leaf_capacity < 1 ? 1 : leaf_capacity;
+			this->max_depth = max_depth;
+		}
+
+		/*
+		* Name: octree_t
+		* Func: Build the octree of points[0] ... points[num_points - 1] at once: the same nodes as inserting them one by one,
+		* but each node partitions its points in place instead of walking from the root for each point.
+		* Runs on "num_threads" threads, 0 for one per hardware thread.
+		*/
+		octree_t(octree_point_t* points, std::size_t num_points, const Vec3& origin, const Vec3& half_dim, std::size_t leaf_capacity = 1, int max_depth = 21,
+			allocation_t allocation = ALLOCATE_POOL, unsigned num_threads = 0)
+			: octree_t(origin, half_dim, leaf_capacity, max_depth, allocation)
+		{
+			build(points, num_points, num_threads);
 		}
 
 		~octree_t()
 		{
-			for (int i = 0; i < 8; ++i) {
-				delete children[i];
+			// With the arena, the root frees every node and bucket at once.
+			if (arena) {
+				if (depth == 0) { delete arena; }
+				return;
 			}
+			if (children) {
+				for (int i = 0; i < 8; ++i) {
+					children[i].~octree_t();
+				}
+				::operator delete(children);
+			}
+			::operator delete(data);
 		}
 
+		octree_t(const octree_t&) = delete;
+		octree_t& operator=(const octree_t&) = delete;
+
 		/*
 		* Name: is_leaf
 		* Func: return true if current node is a leaf node.
@@ -59,11 +226,34 @@ namespace octree
 		*/
 		void insert(octree_point_t* point);
 
+		/*
+		* Name: size
+		* Func: Return the number of points stored in the subtree.
+		*/
+		std::size_t size() const;
+
 		/*
 		* Name: get_points_inside_box
 		* Func: Query the octree for points within a bounding box defined by min/max point.
+		* An octant fully inside the box appends all its points without testing them.
+		*/
+		void get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, std::vector<octree_point_t*>& results) const;
+
+		/*
+		* Name: get_k_nearest
+		* Func: Find the k points nearest to "point", nearest first, with their squared distances. Fewer if the tree has fewer points.
+		* Best-first: nodes are visited in order of distance, and the search stops when the nearest unvisited node
+		* is farther than the k-th nearest point found so far.
+		*/
+		void get_k_nearest(const Vec3& point, std::size_t k, std::vector<octree_point_t*>& results, std::vector<double>& squared_distances,
+			octree_query_scratch_t& scratch) const;
+
+		/*
+		* Name: get_points_inside_radius
+		* Func: Find the points at most "radius" from "point", with their squared distances, in no particular order.
 		*/
-		void get_points_insede_box(const Vec3& box_pmin, const Vec3& box_pmax, std::vector<octree_point_t*>& results);
+		void get_points_inside_radius(const Vec3& point, double radius, std::vector<octree_point_t*>& results, std::vector<double>& squared_distances,
+			octree_query_scratch_t& scratch) const;
 	};
 }
 
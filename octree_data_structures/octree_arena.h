@@ -0,0 +1,90 @@
+#ifndef __octree_arena_h__
+#define __octree_arena_h__
+
+#include<cstddef>
+#include<cstdint>
+#include<new>
+#include<vector>
+
+namespace octree
+{
+	/*
+	* Name: octree_arena_t
+	* Func: Bump allocator for the nodes and the leaf buckets of one octree. Memory is taken from large chunks
+	* and never released one allocation at a time: the destructor frees all the chunks at once.
+	* Nodes are allocated as blocks of 8 siblings, so that the children of a node are contiguous in memory.
+	* @Varia chunks: The chunks allocated so far, the current one last.
+	* @Varia current/remaining: The free part of the current chunk.
+	* @Varia chunk_size: The size of a new chunk, unless an allocation needs more.
+	* @Varia allocated: The bytes handed out so far.
+	*/
+	class octree_arena_t
+	{
+	private:
+		std::vector<char*> chunks;
+		char* current;
+		std::size_t remaining;
+		std::size_t chunk_size;
+		std::size_t allocated;
+
+	public:
+		explicit octree_arena_t(std::size_t chunk_size = std::size_t(1) << 20)
+		{
+			this->current = nullptr;
+			this->remaining = 0;
+			this->chunk_size = chunk_size;
+			this->allocated = 0;
+		}
+
+		~octree_arena_t()
+		{
+			for (char* chunk : chunks) {
+				::operator delete(chunk);
+			}
+		}
+
+		octree_arena_t(const octree_arena_t&) = delete;
+		octree_arena_t& operator=(const octree_arena_t&) = delete;
+
+		/*
+		* Name: allocate
+		* Func: Return "bytes" bytes aligned to "alignment", a power of 2 at most alignof(std::max_align_t).
+		*/
+		void* allocate(std::size_t bytes, std::size_t alignment)
+		{
+			std::size_t padding = (alignment - std::uintptr_t(current) % alignment) % alignment;
+			if (current == nullptr || padding + bytes > remaining) {
+				const std::size_t size = bytes > chunk_size ? bytes : chunk_size;
+				current = static_cast<char*>(::operator new(size));
+				chunks.push_back(current);
+				remaining = size;
+				padding = 0;
+			}
+			void* result = current + padding;
+			current += padding + bytes;
+			remaining -= padding + bytes;
+			allocated += bytes;
+			return result;
+		}
+
+		/*
+		* Name: adopt
+		* Func: Take over the chunks of "other", which is left empty: they are freed with this arena.
+		* Lets threads allocate from arenas of their own and hand the memory to one arena afterwards.
+		*/
+		void adopt(octree_arena_t& other)
+		{
+			chunks.insert(chunks.begin(), other.chunks.begin(), other.chunks.end());
+			allocated += other.allocated;
+			other.chunks.clear();
+			other.current = nullptr;
+			other.remaining = 0;
+			other.allocated = 0;
+		}
+
+		// Without the padding and the unused tails of the chunks.
+		std::size_t allocated_bytes() const { return allocated; }
+	};
+}
+
+#endif // !__octree_arena_h__
@@ -0,0 +1,107 @@
+#include"octree_batch.h"
+#include"parallel.h"
+#include<algorithm>
+#include<atomic>
+
+namespace octree
+{
+	namespace
+	{
+		// Queries per block taken by a thread.
+		const std::size_t block_size = 64;
+	}
+
+	octree_batch_t::octree_batch_t(unsigned num_threads)
+	{
+		this->num_threads = resolve_num_threads(num_threads);
+		threads.resize(this->num_threads);
+	}
+
+	template<typename query_t>
+	void octree_batch_t::run(std::size_t num_queries, const octree_point_t* points, bool with_distances, const query_t& query,
+		std::vector<std::size_t>& offsets, std::vector<std::size_t>& indices, std::vector<double>* squared_distances)
+	{
+		offsets.resize(num_queries + 1);
+		offsets[0] = 0;
+		const unsigned used_threads = unsigned(std::min<std::size_t>(num_threads, (num_queries + block_size - 1) / block_size));
+		if (used_threads == 0) {
+			indices.clear();
+			if (squared_distances) { squared_distances->clear(); }
+			return;
+		}
+
+		// Each thread answers blocks of queries into its own buffers, and writes the number of results of each query.
+		std::atomic<std::size_t> next(0);
+		run_on_threads(used_threads, [&](unsigned t) {
+			thread_t& thread = threads[t];
+			thread.indices.clear();
+			thread.squared_distances.clear();
+			thread.blocks.clear();
+			for (;;) {
+				const std::size_t first = next.fetch_add(block_size);
+				if (first >= num_queries) { break; }
+				block_t block;
+				block.first = first;
+				block.begin = thread.indices.size();
+				thread.blocks.push_back(block);
+
+				const std::size_t last = std::min(first + block_size, num_queries);
+				for (std::size_t q = first; q < last; ++q) {
+					query(q, thread);
+					for (octree_point_t* point : thread.points) {
+						thread.indices.push_back(point - points);
+					}
+					if (with_distances) {
+						thread.squared_distances.insert(thread.squared_distances.end(), thread.distances.begin(), thread.distances.end());
+					}
+					offsets[q + 1] = thread.points.size();
+				}
+			}
+		});
+
+		for (std::size_t q = 0; q < num_queries; ++q) {
+			offsets[q + 1] += offsets[q];
+		}
+
+		// Then copies its blocks to their place in the flat arrays.
+		indices.resize(offsets[num_queries]);
+		if (squared_distances) { squared_distances->resize(offsets[num_queries]); }
+		run_on_threads(used_threads, [&](unsigned t) {
+			const thread_t& thread = threads[t];
+			for (const block_t& block : thread.blocks) {
+				const std::size_t last = std::min(block.first + block_size, num_queries);
+				const std::size_t count = offsets[last] - offsets[block.first];
+				std::copy(thread.indices.begin() + block.begin, thread.indices.begin() + block.begin + count, indices.begin() + offsets[block.first]);
+				if (squared_distances) {
+					std::copy(thread.squared_distances.begin() + block.begin, thread.squared_distances.begin() + block.begin + count,
+						squared_distances->begin() + offsets[block.first]);
+				}
+			}
+		});
+	}
+
+	void octree_batch_t::get_points_insede_boxes(const octree_t& tree, const octree_point_t* points, const Vec3* box_pmin, const Vec3* box_pmax, std::size_t num_boxes,
+		std::vector<std::size_t>& offsets, std::vector<std::size_t>& indices)
+	{
+		run(num_boxes, points, false, [&](std::size_t q, thread_t& thread) {
+			thread.points.clear();
+			tree.get_points_insede_box(box_pmin[q], box_pmax[q], thread.points);
+		}, offsets, indices, nullptr);
+	}
+
+	void octree_batch_t::get_k_nearest(const octree_t& tree, const octree_point_t* points, const Vec3* query_points, std::size_t num_queries, std::size_t k,
+		std::vector<std::size_t>& offsets, std::vector<std::size_t>& indices, std::vector<double>& squared_distances)
+	{
+		run(num_queries, points, true, [&](std::size_t q, thread_t& thread) {
+			tree.get_k_nearest(query_points[q], k, thread.points, thread.distances, thread.scratch);
+		}, offsets, indices, &squared_distances);
+	}
+
+	void octree_batch_t::get_points_inside_radius(const octree_t& tree, const octree_point_t* points, const Vec3* query_points, std::size_t num_queries, double radius,
+		std::vector<std::size_t>& offsets, std::vector<std::size_t>& indices, std::vector<double>& squared_distances)
+	{
+		run(num_queries, points, true, [&](std::size_t q, thread_t& thread) {
+			tree.get_points_inside_radius(query_points[q], radius, thread.points, thread.distances, thread.scratch);
+		}, offsets, indices, &squared_distances);
+	}
+}
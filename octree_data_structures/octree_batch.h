@@ -0,0 +1,80 @@
+#ifndef __octree_batch_h__
+#define __octree_batch_h__
+
+#include"octree.h"
+#include<cstddef>
+#include<vector>
+
+namespace octree
+{
+	/*
+	* Name: octree_batch_t
+	* Func: Run many queries against one octree on several threads, with the results of all the queries in two flat arrays:
+	* the results of query q are indices[offsets[q]] ... indices[offsets[q + 1] - 1], where an index is the position
+	* of the point in the array "points" it was inserted from. The k-NN and radius queries also fill "squared_distances" alike.
+	* Threads take blocks of queries as they go, so that expensive queries don't leave the other threads idle.
+	* The per-thread buffers are kept between batches: reuse the object, e.g. once per frame, to avoid allocations.
+	* @Varia threads: The buffers of each thread.
+	* @Varia num_threads: The number of threads, 0 for one per hardware thread.
+	*/
+	class octree_batch_t
+	{
+	private:
+		/*
+		* Name: block_t
+		* Func: The results of queries [first, first + 64) computed by one thread, starting at "begin" in its buffers.
+		*/
+		struct block_t
+		{
+			std::size_t first;
+			std::size_t begin;
+		};
+
+		struct thread_t
+		{
+			octree_query_scratch_t scratch;
+			std::vector<octree_point_t*> points;
+			std::vector<double> distances;
+			std::vector<std::size_t> indices;
+			std::vector<double> squared_distances;
+			std::vector<block_t> blocks;
+		};
+
+		std::vector<thread_t> threads;
+		unsigned num_threads;
+
+		/*
+		* Name: run
+		* Func: Call query(q, thread) for each query q, which leaves its results in thread.points/distances, and gather them.
+		*/
+		template<typename query_t>
+		void run(std::size_t num_queries, const octree_point_t* points, bool with_distances, const query_t& query,
+			std::vector<std::size_t>& offsets, std::vector<std::size_t>& indices, std::vector<double>* squared_distances);
+
+	public:
+		explicit octree_batch_t(unsigned num_threads = 0);
+
+		/*
+		* Name: get_points_insede_boxes
+		* Func: Query the octree for the points within each box [box_pmin[q], box_pmax[q]].
+		*/
+		void get_points_insede_boxes(const octree_t& tree, const octree_point_t* points, const Vec3* box_pmin, const Vec3* box_pmax, std::size_t num_boxes,
+			std::vector<std::size_t>& offsets, std::vector<std::size_t>& indices);
+
+		/*
+		* Name: get_k_nearest
+		* Func: Find the k points nearest to each query point, nearest first.
+		*/
+		void get_k_nearest(const octree_t& tree, const octree_point_t* points, const Vec3* query_points, std::size_t num_queries, std::size_t k,
+			std::vector<std::size_t>& offsets, std::vector<std::size_t>& indices, std::vector<double>& squared_distances);
+
+		/*
+		* Name: get_points_inside_radius
+		* Func: Find the points at most "radius" from each query point.
+		*/
+		void get_points_inside_radius(const octree_t& tree, const octree_point_t* points, const Vec3* query_points, std::size_t num_queries, double radius,
+			std::vector<std::size_t>& offsets, std::vector<std::size_t>& indices, std::vector<double>& squared_distances);
+	};
+}
+
+#endif // !__octree_batch_h__
@@ -0,0 +1,72 @@
+#ifndef __octree_parallel_h__
+#define __octree_parallel_h__
+
+#include<cstddef>
+#include<thread>
+#include<vector>
+
+namespace octree
+{
+	/*
+	* Name: resolve_num_threads
+	* Func: Return the number of threads to use. 0 means one thread per hardware thread.
+	*/
+	inline unsigned resolve_num_threads(unsigned num_threads)
+	{
+		if (num_threads == 0) {
+			num_threads = std::thread::hardware_concurrency();
+		}
+		return num_threads == 0 ? 1 : num_threads;
+	}
+
+	/*
+	* Name: parallel_for
+	* Func: Split [begin, end) into "num_threads" contiguous chunks and call f(thread, chunk_begin, chunk_end) on each of them.
+	* The chunks only depend on the range and "num_threads", so two calls with the same arguments see the same chunks.
+	* Small ranges run all the chunks on the calling thread.
+	*/
+	template<typename function_t>
+	void parallel_for(std::size_t begin, std::size_t end, unsigned num_threads, const function_t& f)
+	{
+		const std::size_t min_chunk = 4096;
+		const std::size_t n = end > begin ? end - begin : 0;
+		num_threads = num_threads == 0 ? 1 : num_threads;
+
+		auto chunk = [&](unsigned t) {
+			const std::size_t b = begin + n * t / num_threads;
+			const std::size_t e = begin + n * (t + 1) / num_threads;
+			f(t, b, e);
+		};
+
+		if (num_threads == 1 || n < min_chunk * 2) {
+			for (unsigned t = 0; t < num_threads; ++t) { chunk(t); }
+			return;
+		}
+
+		std::vector<std::thread> workers;
+		workers.reserve(num_threads - 1);
+		for (unsigned t = 1; t < num_threads; ++t) {
+			workers.emplace_back(chunk, t);
+		}
+		chunk(0);
+		for (auto& w : workers) { w.join(); }
+	}
+
+	/*
+	* Name: run_on_threads
+	* Func: Call f(t) for t = 0 ... num_threads - 1, each on its own thread, the first one on the calling thread.
+	*/
+	template<typename function_t>
+	void run_on_threads(unsigned num_threads, const function_t& f)
+	{
+		std::vector<std::thread> workers;
+		workers.reserve(num_threads - 1);
+		for (unsigned t = 1; t < num_threads; ++t) {
+			workers.emplace_back(f, t);
+		}
+		f(0);
+		for (auto& w : workers) { w.join(); }
+	}
+}
+
+#endif // !__octree_parallel_h__